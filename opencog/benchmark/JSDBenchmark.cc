@@ -0,0 +1,95 @@
+/*
+ * JSDBenchmark.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Microbenchmark comparing the one pair at a time Jensen-Shannon
+// distance with its batch version.
+//
+// Usage: jsd-benchmark [PAIRS] [BINS] [REPEATS]
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencog/util/random.h>
+#include <opencog/atoms/truthvalue/SimpleTruthValue.h>
+#include <opencog/miner/Surprisingness.h>
+
+using namespace opencog;
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed(const bench_clock::time_point& start)
+{
+	return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+static TruthValuePtr random_tv()
+{
+	count_t n = 1 + randGen().randint(1000);
+	count_t x = randGen().randint(n + 1);
+	return createSimpleTruthValue(x / n, Surprisingness::count_to_confidence(n));
+}
+
+int main(int argc, char** argv)
+{
+	size_t pairs = 1 < argc ? std::stoul(argv[1]) : 10000;
+	int bins = 2 < argc ? std::stoi(argv[2]) : 100;
+	unsigned repeats = 3 < argc ? std::stoul(argv[3]) : 5;
+
+	randGen().seed(0);
+	TruthValueSeq l_tvs, r_tvs;
+	for (size_t i = 0; i < pairs; i++) {
+		l_tvs.push_back(random_tv());
+		r_tvs.push_back(random_tv());
+	}
+
+	// The scalar path uses the bins of Surprisingness::jsd, thus is
+	// only comparable to the batch one when bins is 100.
+	std::vector<double> scalar(pairs), batch;
+	double scalar_time = 0.0, batch_time = 0.0;
+	for (unsigned r = 0; r < repeats; r++) {
+		bench_clock::time_point start = bench_clock::now();
+		for (size_t i = 0; i < pairs; i++)
+			scalar[i] = Surprisingness::jsd(l_tvs[i], r_tvs[i]);
+		scalar_time += elapsed(start);
+
+		start = bench_clock::now();
+		Surprisingness::jsd(l_tvs, r_tvs, batch, bins);
+		batch_time += elapsed(start);
+	}
+
+	double max_error = 0.0;
+	for (size_t i = 0; i < pairs; i++)
+		max_error = std::max(max_error, std::abs(scalar[i] - batch[i]));
+
+	std::cout << "{\"pairs\": " << pairs
+	          << ", \"bins\": " << bins
+	          << ", \"repeats\": " << repeats
+	          << ", \"scalar_seconds\": " << scalar_time / repeats
+	          << ", \"batch_seconds\": " << batch_time / repeats
+	          << ", \"speedup\": " << scalar_time / batch_time
+	          << ", \"max_error\": " << max_error
+	          << "}" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,347 @@
+/*
+ * MinerBenchmark.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Benchmark of the main operations of the miner, the C++ miner, the
+// shallow specializations and conjunction expansions behind
+// cog-shallow-specialize and cog-expand-conjunction, and the
+// I-Surprisingness, over synthetic datasets of various sizes (see
+// SyntheticKB) and the datasets bundled with the repository. Results,
+// throughput, latency percentiles and memory growth of each dataset,
+// and peak resident memory of the whole run, are printed in JSON.
+//
+// Usage: miner-benchmark [OPTIONS] [FILE...]
+//
+// --scale N     Number of data trees of a synthetic dataset, can be
+//               repeated (default 1000 and 10000).
+// --minsup R    Minimum support, as a ratio of the number of data
+//               trees (default 0.05).
+// --repeats N   Number of runs of the C++ miner (default 3).
+// --calls N     Maximum number of calls of the other operations
+//               (default 100).
+// --planted N   Number of patterns planted in synthetic datasets, the
+//               recall of which is measured by mining conjunctions
+//               (default 2).
+//
+// FILE are Scheme files of data trees, by default the ones under
+// tests/miner/scm and examples/miner/*/kb.scm.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <opencog/util/Logger.h>
+#include <opencog/util/platform.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/guile/SchemeEval.h>
+#include <opencog/miner/Miner.h>
+#include <opencog/miner/MinerUtils.h>
+#include <opencog/miner/MinerLogger.h>
+#include <opencog/miner/Surprisingness.h>
+#include <opencog/miner/SyntheticKB.h>
+
+using namespace opencog;
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct Options
+{
+	std::vector<size_t> scales;
+	double minsup = 0.05;
+	unsigned repeats = 3;
+	size_t calls = 100;
+	unsigned planted = 2;
+	std::vector<std::string> files;
+};
+
+static double elapsed(const bench_clock::time_point& start)
+{
+	return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+/**
+ * Return the peak resident memory of the process in KB, since its
+ * start, thus over all datasets so far.
+ */
+static long peak_rss_kb()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/**
+ * Return the memory usage of the process in KB.
+ */
+static long long memory_kb()
+{
+	return getMemUsage() / 1024;
+}
+
+static std::string json_string(const std::string& str)
+{
+	std::string json = "\"";
+	for (char c : str) {
+		if (c == '"' or c == '\\')
+			json += '\\';
+		json += c;
+	}
+	return json + "\"";
+}
+
+/**
+ * Return the q-th quantile of sorted latencies, in milliseconds.
+ */
+static double percentile(const std::vector<double>& sorted, double q)
+{
+	if (sorted.empty())
+		return 0.0;
+	size_t i = std::lround(q * (sorted.size() - 1));
+	return 1000.0 * sorted[i];
+}
+
+/**
+ * Return the JSON summary of the latencies of an operation, given the
+ * total number of items (patterns, specializations, etc) produced.
+ */
+static std::string summary(std::vector<double> latencies, size_t items)
+{
+	std::sort(latencies.begin(), latencies.end());
+	double total = 0.0;
+	for (double l : latencies)
+		total += l;
+	std::stringstream ss;
+	ss << "{\"calls\": " << latencies.size()
+	   << ", \"items\": " << items
+	   << ", \"seconds\": " << total
+	   << ", \"calls_per_second\": " << (0 < total ? latencies.size() / total : 0)
+	   << ", \"items_per_second\": " << (0 < total ? items / total : 0)
+	   << ", \"p50_ms\": " << percentile(latencies, 0.5)
+	   << ", \"p90_ms\": " << percentile(latencies, 0.9)
+	   << ", \"p99_ms\": " << percentile(latencies, 0.99)
+	   << ", \"max_ms\": " << percentile(latencies, 1.0)
+	   << "}";
+	return ss.str();
+}
+
+/**
+ * Mine conjunctions of as many conjuncts as the planted patterns, and
+ * return the JSON report of the recall of the planted patterns.
+ */
+static std::string recall(const HandleSeq& db, unsigned ms,
+                          const HandleSeq& planted)
+{
+	unsigned conjuncts = MinerUtils::n_conjuncts(planted.front());
+	Miner miner(MinerParameters(ms, conjuncts));
+	bench_clock::time_point start = bench_clock::now();
+	HandleTree results = miner(db);
+	double time = elapsed(start);
+	HandleSeq patterns(results.begin(), results.end());
+
+	std::stringstream ss;
+	ss << "{\"conjuncts\": " << conjuncts
+	   << ", \"planted\": " << planted.size()
+	   << ", \"patterns\": " << patterns.size()
+	   << ", \"seconds\": " << time
+	   << ", \"recall\": " << SyntheticKB::recall(planted, patterns)
+	   << "}";
+	return ss.str();
+}
+
+/**
+ * Run all benchmarks over the data trees of as, and return their JSON
+ * results. If there are planted patterns, report their recall as well.
+ */
+static std::string run(AtomSpace& as, const Options& opts,
+                       const HandleSeq& planted={})
+{
+	HandleSeq db;
+	as.get_handles_by_type(db, opencog::ATOM, true);
+	unsigned ms = std::max(1.0, std::ceil(opts.minsup * db.size()));
+
+	// C++ miner
+	std::vector<double> miner_latencies;
+	HandleSeq patterns;
+	size_t n_patterns = 0;
+	for (unsigned r = 0; r < opts.repeats; r++) {
+		Miner miner(MinerParameters(ms));
+		bench_clock::time_point start = bench_clock::now();
+		HandleTree results = miner(db);
+		miner_latencies.push_back(elapsed(start));
+		patterns.assign(results.begin(), results.end());
+		n_patterns += patterns.size();
+	}
+
+	// The other operations are run over the mined patterns and the
+	// initial one.
+	if (opts.calls < patterns.size())
+		patterns.resize(opts.calls);
+	patterns.insert(patterns.begin(), MinerParameters(ms).initpat);
+
+	// Shallow specialization
+	std::vector<double> shaspe_latencies;
+	size_t n_shaspes = 0;
+	for (const Handle& pattern : patterns) {
+		bench_clock::time_point start = bench_clock::now();
+		HandleSet shaspes = MinerUtils::shallow_specialize(pattern, db, ms);
+		shaspe_latencies.push_back(elapsed(start));
+		n_shaspes += shaspes.size();
+	}
+
+	// Conjunction expansion, of all pairs of patterns till enough
+	// calls have been made. Conjunctions are kept for surprisingness.
+	std::vector<double> expand_latencies;
+	HandleSeq cnjtions;
+	for (size_t i = 0; i < patterns.size(); i++) {
+		for (size_t j = i; j < patterns.size(); j++) {
+			if (opts.calls <= expand_latencies.size())
+				break;
+			bench_clock::time_point start = bench_clock::now();
+			HandleSet expansions =
+				MinerUtils::expand_conjunction(patterns[i], patterns[j],
+				                               db, ms);
+			expand_latencies.push_back(elapsed(start));
+			cnjtions.insert(cnjtions.end(),
+			                expansions.begin(), expansions.end());
+		}
+	}
+
+	// I-Surprisingness
+	std::vector<double> isurp_latencies;
+	for (size_t i = 0; i < std::min(cnjtions.size(), opts.calls); i++) {
+		bench_clock::time_point start = bench_clock::now();
+		Surprisingness::isurp(cnjtions[i], db);
+		isurp_latencies.push_back(elapsed(start));
+	}
+
+	std::stringstream ss;
+	ss << "\"data_trees\": " << db.size()
+	   << ", \"minsup\": " << ms
+	   << ", \"miner\": " << summary(miner_latencies, n_patterns)
+	   << ", \"shallow_specialize\": " << summary(shaspe_latencies, n_shaspes)
+	   << ", \"expand_conjunction\": " << summary(expand_latencies,
+	                                              cnjtions.size())
+	   << ", \"isurp\": " << summary(isurp_latencies, isurp_latencies.size());
+	if (not planted.empty())
+		ss << ", \"recall\": " << recall(db, ms, planted);
+	return ss.str();
+}
+
+static Options parse_options(int argc, char** argv)
+{
+	Options opts;
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		bool has_value = i + 1 < argc;
+		if (arg == "--scale" and has_value)
+			opts.scales.push_back(std::stoul(argv[++i]));
+		else if (arg == "--minsup" and has_value)
+			opts.minsup = std::stod(argv[++i]);
+		else if (arg == "--repeats" and has_value)
+			opts.repeats = std::stoul(argv[++i]);
+		else if (arg == "--calls" and has_value)
+			opts.calls = std::stoul(argv[++i]);
+		else if (arg == "--planted" and has_value)
+			opts.planted = std::stoul(argv[++i]);
+		else
+			opts.files.push_back(arg);
+	}
+
+	if (opts.scales.empty())
+		opts.scales = {1000, 10000};
+	if (opts.files.empty())
+		opts.files = {
+			PROJECT_SOURCE_DIR "/tests/miner/scm/ugly-male-soda-drinker-corpus.scm",
+			PROJECT_SOURCE_DIR "/tests/miner/scm/QA_knowledge_base_v2_no_duplicates.scm",
+			PROJECT_SOURCE_DIR "/tests/miner/scm/inference-control-corpus.scm",
+			PROJECT_SOURCE_DIR "/tests/miner/scm/lojban-dataset.scm",
+			PROJECT_SOURCE_DIR "/examples/miner/ugly-male-soda-drinker/kb.scm"
+		};
+	return opts;
+}
+
+int main(int argc, char** argv)
+{
+	Options opts = parse_options(argc, argv);
+	logger().set_level(Logger::WARN);
+	miner_logger().set_level(Logger::WARN);
+
+	std::cout << "{\"minsup_ratio\": " << opts.minsup
+	          << ", \"repeats\": " << opts.repeats
+	          << ", \"calls\": " << opts.calls
+	          << ", \"datasets\": [";
+
+	bool first = true;
+	for (size_t scale : opts.scales) {
+		// Planted patterns are given twice the minimum support ratio,
+		// so that they remain frequent despite the data trees of
+		// their own groundings.
+		SyntheticKBParameters param(scale, std::max((size_t)2, scale / 10));
+		param.planted = opts.planted;
+		param.support = 2 * opts.minsup;
+		SyntheticKB kb(param);
+		long long memory = memory_kb();
+		AtomSpacePtr asp = createAtomSpace();
+		bench_clock::time_point start = bench_clock::now();
+		kb(*asp);
+		double load_time = elapsed(start);
+		std::string report = run(*asp, opts, kb.planted());
+		std::cout << (first ? "" : ", ")
+		          << "{\"name\": " << json_string("synthetic-"
+		                                          + std::to_string(scale))
+		          << ", \"load_seconds\": " << load_time
+		          << ", " << report
+		          << ", \"memory_growth_kb\": " << memory_kb() - memory << "}"
+		          << std::flush;
+		first = false;
+	}
+
+	for (const std::string& file : opts.files) {
+		long long memory = memory_kb();
+		AtomSpacePtr asp = createAtomSpace();
+		SchemeEval scm(asp.get());
+		scm.eval("(use-modules (opencog))");
+		bench_clock::time_point start = bench_clock::now();
+		std::string rs = scm.eval("(load " + json_string(file) + ")");
+		double load_time = elapsed(start);
+		if (scm.eval_error()) {
+			std::cerr << "Cannot load " << file << ": " << rs << std::endl;
+			continue;
+		}
+		std::string report = run(*asp, opts);
+		std::cout << (first ? "" : ", ")
+		          << "{\"name\": " << json_string(file)
+		          << ", \"load_seconds\": " << load_time
+		          << ", " << report
+		          << ", \"memory_growth_kb\": " << memory_kb() - memory << "}"
+		          << std::flush;
+		first = false;
+	}
+
+	std::cout << "], \"peak_rss_kb\": " << peak_rss_kb() << "}" << std::endl;
+
+	return 0;
+}
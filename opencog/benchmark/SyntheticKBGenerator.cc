@@ -0,0 +1,118 @@
+/*
+ * SyntheticKBGenerator.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Generate a synthetic knowledge base (see SyntheticKB) and print its
+// data trees as Atomese on the standard output, loadable by Scheme or
+// cog-load-db. The planted patterns are printed on the standard
+// error.
+//
+// Usage: synthetic-kb [OPTIONS]
+//
+// --data-trees N    Number of background data trees (default 10000).
+// --nodes N         Number of nodes per node type (default 1000).
+// --node-type T     Node type, can be repeated (default ConceptNode).
+// --link-type T:A   Link type and arity, can be repeated (default
+//                   InheritanceLink:2).
+// --zipf S          Exponent of the Zipfian distribution (default 1).
+// --depth N         Depth of the ontology (default 0).
+// --branching N     Branching factor of the ontology (default 4).
+// --planted N       Number of planted patterns (default 0).
+// --conjuncts N     Number of conjuncts of planted patterns (default 2).
+// --support R       Support of planted patterns, as a ratio of the
+//                   number of background data trees (default 0.01).
+// --seed N          Seed of the random generator (default 0).
+
+#include <iostream>
+#include <string>
+
+#include <opencog/atoms/atom_types/NameServer.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/miner/SyntheticKB.h>
+
+using namespace opencog;
+
+static Type get_type(const std::string& name)
+{
+	Type type = nameserver().getType(name);
+	if (type == NOTYPE) {
+		std::cerr << "Unknown type " << name << std::endl;
+		exit(1);
+	}
+	return type;
+}
+
+int main(int argc, char** argv)
+{
+	SyntheticKBParameters param;
+	bool default_node_types = true, default_link_types = true;
+	if (argc % 2 == 0) {
+		std::cerr << "Missing value of option " << argv[argc - 1] << std::endl;
+		return 1;
+	}
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string arg(argv[i]), value(argv[i + 1]);
+		if (arg == "--data-trees")
+			param.data_trees = std::stoul(value);
+		else if (arg == "--nodes")
+			param.nodes = std::stoul(value);
+		else if (arg == "--node-type") {
+			if (default_node_types)
+				param.node_types.clear();
+			default_node_types = false;
+			param.node_types.push_back(get_type(value));
+		} else if (arg == "--link-type") {
+			if (default_link_types)
+				param.link_types.clear();
+			default_link_types = false;
+			size_t colon = value.find(':');
+			Arity arity = colon == std::string::npos ? 2
+				: std::stoul(value.substr(colon + 1));
+			param.link_types.emplace_back(get_type(value.substr(0, colon)),
+			                              arity);
+		} else if (arg == "--zipf")
+			param.zipf = std::stod(value);
+		else if (arg == "--depth")
+			param.depth = std::stoul(value);
+		else if (arg == "--branching")
+			param.branching = std::stoul(value);
+		else if (arg == "--planted")
+			param.planted = std::stoul(value);
+		else if (arg == "--conjuncts")
+			param.conjuncts = std::stoul(value);
+		else if (arg == "--support")
+			param.support = std::stod(value);
+		else if (arg == "--seed")
+			param.seed = std::stoul(value);
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	AtomSpacePtr asp = createAtomSpace();
+	SyntheticKB kb(param);
+	for (const Handle& tree : kb(*asp))
+		std::cout << tree->to_short_string() << std::endl;
+	for (const Handle& pattern : kb.planted())
+		std::cerr << pattern->to_short_string() << std::endl;
+
+	return 0;
+}
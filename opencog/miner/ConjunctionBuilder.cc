@@ -0,0 +1,189 @@
+/*
+ * ConjunctionBuilder.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ConjunctionBuilder.h"
+#include "MinerUtils.h"
+
+#include <opencog/util/algorithm.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/core/FindUtils.h>
+
+namespace opencog
+{
+
+ConjunctionBuilder::ConjunctionBuilder(const Handle& cnjtion,
+                                       const Handle& pattern)
+	: _cnjtion(cnjtion), _pattern(pattern), _incremental(true)
+{
+	// Only untyped variable declarations are built incrementally
+	const Variables& cvars = MinerUtils::get_variables(cnjtion);
+	const Variables& pvars = MinerUtils::get_variables(pattern);
+	Handle cvardecl = MinerUtils::get_vardecl(cnjtion);
+	_incremental = cvars._typemap.empty() and pvars._typemap.empty()
+		and cvardecl and cvardecl->get_type() == VARIABLE_SET;
+	for (const Handle& var : cvars.varseq)
+		_incremental = _incremental and var->get_type() == VARIABLE_NODE;
+	for (const Handle& var : pvars.varseq)
+		_incremental = _incremental and var->get_type() == VARIABLE_NODE;
+	if (not _incremental)
+		return;
+
+	_cnjtion_clauses = MinerUtils::get_clauses(cnjtion);
+	for (const Handle& clause : _cnjtion_clauses)
+		_cnjtion_clause_vars.push_back(get_free_variables(clause));
+}
+
+bool ConjunctionBuilder::is_for(const Handle& cnjtion,
+                                const Handle& pattern) const
+{
+	return _cnjtion == cnjtion and _pattern == pattern;
+}
+
+Handle ConjunctionBuilder::operator()(const HandleMap& pv2cv) const
+{
+	if (not _incremental)
+		return build_from_scratch(pv2cv);
+
+	const Variables& cvars = MinerUtils::get_variables(_cnjtion);
+	const Variables& pvars = MinerUtils::get_variables(_pattern);
+
+	// Variables of the expansion, the variables of cnjtion followed by
+	// the unmapped variables of pattern.
+	HandleSeq nvars(cvars.varseq);
+	for (const Handle& pv : pvars.varseq)
+		if (pv2cv.find(pv) == pv2cv.end())
+			nvars.push_back(pv);
+	HandleSet nvarset(nvars.begin(), nvars.end());
+
+	// Substitute pattern variables by cnjtion variables in pattern
+	Handle npat_body = pvars.substitute_nocheck(MinerUtils::get_body(_pattern),
+	                                            pv2cv);
+
+	// Gather the clauses of the expansion, the ones of cnjtion
+	// followed by the new ones, discarding constant new clauses
+	// (cnjtion has none).
+	HandleSeq clauses(_cnjtion_clauses);
+	std::vector<const HandleSet*> clause_vars;
+	for (const HandleSet& vars : _cnjtion_clause_vars)
+		clause_vars.push_back(&vars);
+	HandleSeq new_clauses = MinerUtils::get_clauses_of_body(npat_body);
+	std::vector<HandleSet> new_clause_vars;
+	new_clause_vars.reserve(new_clauses.size());
+	for (const Handle& clause : new_clauses) {
+		HandleSet vars = get_free_variables(clause);
+		bool constant = true;
+		for (const Handle& var : vars)
+			constant = constant and nvarset.find(var) == nvarset.end();
+		if (constant)
+			continue;
+		clauses.push_back(clause);
+		new_clause_vars.push_back(std::move(vars));
+		clause_vars.push_back(&new_clause_vars.back());
+	}
+	size_t n_old = _cnjtion_clauses.size();
+	size_t n = clauses.size();
+
+	// Variables of the new clauses and the removed ones. Clauses of
+	// cnjtion that do not contain any of them cannot become useless.
+	HandleSet touched_vars;
+	for (size_t i = n_old; i < n; i++)
+		touched_vars.insert(clause_vars[i]->begin(), clause_vars[i]->end());
+	auto is_touched = [&](size_t i) {
+		for (const Handle& var : *clause_vars[i])
+			if (touched_vars.find(var) != touched_vars.end())
+				return true;
+		return false;
+	};
+
+	// Remove redundant subclauses, like
+	// MinerUtils::remove_redundant_subclauses, but not checking
+	// clauses of cnjtion against each other.
+	std::vector<bool> removed(n, false);
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < n; j++) {
+			if (j == i or removed[j] or (i < n_old and j < n_old))
+				continue;
+			if (is_unquoted_unscoped_in_tree(clauses[j], clauses[i])) {
+				removed[i] = true;
+				touched_vars.insert(clause_vars[i]->begin(),
+				                    clause_vars[i]->end());
+				break;
+			}
+		}
+	}
+
+	// Remove abstract clauses, like
+	// MinerUtils::remove_abstract_clauses, but only checking new
+	// clauses and the clauses of cnjtion they may affect.
+	for (size_t i = 0; i < n; i++) {
+		if (removed[i] or (i < n_old and not is_touched(i)))
+			continue;
+		MinerUtils::ClauseView others(clauses, removed, i);
+		if (MinerUtils::is_more_abstract_foreach_var(clauses[i], others)) {
+			removed[i] = true;
+			touched_vars.insert(clause_vars[i]->begin(),
+			                    clause_vars[i]->end());
+		}
+	}
+
+	HandleSeq nclauses;
+	for (size_t i = 0; i < n; i++)
+		if (not removed[i])
+			nclauses.push_back(clauses[i]);
+
+	// Build the variable declaration the way Variables::get_vardecl
+	// would for an unordered declaration.
+	Handle nvardecl = nvars.size() == 1 ? nvars.front()
+		: Handle(createLink(std::move(nvars), VARIABLE_SET));
+
+	return MinerUtils::mk_pattern(nvardecl, nclauses);
+}
+
+Handle ConjunctionBuilder::build_from_scratch(const HandleMap& pv2cv) const
+{
+	// Substitute pattern variables by cnjtion variables in pattern
+	Variables pattern_vars = MinerUtils::get_variables(_pattern);
+	Handle npat_body =
+		pattern_vars.substitute_nocheck(MinerUtils::get_body(_pattern), pv2cv);
+	for (const auto& el : pv2cv)
+		pattern_vars.erase(el.first);
+
+	// Extend cnjtion variables with the pattern variables, except
+	// mapped variables
+	Variables cnjtion_vars = MinerUtils::get_variables(_cnjtion);
+	cnjtion_vars.extend(pattern_vars);
+
+	// Expand cnjtion body with npat_body, flattening cnjtion_body if necessary
+	HandleSeq nclauses = MinerUtils::get_clauses(_cnjtion);
+	append(nclauses, MinerUtils::get_clauses_of_body(npat_body));
+
+	// get new variable declaration
+	Handle nvardecl = cnjtion_vars.get_vardecl();
+
+	// Remove useless clauses, such as constant, redundant or abstract
+	// clauses.
+	MinerUtils::remove_useless_clauses(nvardecl, nclauses);
+
+	// Recreate expanded conjunction
+	return MinerUtils::mk_pattern(nvardecl, nclauses);
+}
+
+} // ~namespace opencog
@@ -0,0 +1,90 @@
+/*
+ * ConjunctionBuilder.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_CONJUNCTIONBUILDER_H_
+#define OPENCOG_CONJUNCTIONBUILDER_H_
+
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atoms/core/Variables.h>
+
+class MinerUTest;
+
+namespace opencog
+{
+
+/**
+ * Incremental builder of the expansions of a conjunction by a
+ * pattern, given variable mappings from pattern to conjunction (see
+ * MinerUtils::expand_conjunction_connect).
+ *
+ * The clauses and variables of the conjunction and the pattern are
+ * extracted once at construction. Then, for each mapping, only the
+ * pattern clauses are substituted, and since the clauses of the
+ * conjunction are assumed to be already free of useless clauses (see
+ * MinerUtils::remove_useless_clauses), only the new clauses, and the
+ * conjunction clauses they may affect, that is sharing variables with
+ * new or removed clauses, are checked for uselessness.
+ *
+ * If the conjunction or the pattern has typed variables, or if the
+ * variable declaration of the conjunction is not a VariableSet, the
+ * builder falls back to rebuilding the expansion from scratch.
+ */
+class ConjunctionBuilder
+{
+    friend class ::MinerUTest;
+public:
+	/**
+	 * CTor. pattern is assumed not to collide with cnjtion.
+	 */
+	ConjunctionBuilder(const Handle& cnjtion, const Handle& pattern);
+
+	/**
+	 * Return true iff the builder has been constructed for cnjtion
+	 * and pattern.
+	 */
+	bool is_for(const Handle& cnjtion, const Handle& pattern) const;
+
+	/**
+	 * Build the expansion of cnjtion by pattern according to pv2cv.
+	 */
+	Handle operator()(const HandleMap& pv2cv) const;
+
+private:
+	/**
+	 * Rebuild the expansion from scratch.
+	 */
+	Handle build_from_scratch(const HandleMap& pv2cv) const;
+
+	Handle _cnjtion;
+	Handle _pattern;
+
+	// Whether the expansion can be built incrementally
+	bool _incremental;
+
+	// Clauses of cnjtion, and their free variables
+	HandleSeq _cnjtion_clauses;
+	std::vector<HandleSet> _cnjtion_clause_vars;
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_CONJUNCTIONBUILDER_H_ */
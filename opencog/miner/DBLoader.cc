@@ -0,0 +1,326 @@
+/*
+ * DBLoader.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "DBLoader.h"
+#include "MinerUtils.h"
+#include "MinerLogger.h"
+
+#include <opencog/util/exceptions.h>
+#include <opencog/atoms/atom_types/NameServer.h>
+#include <opencog/atoms/base/Atom.h>
+#include <opencog/atoms/truthvalue/SimpleTruthValue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace opencog
+{
+
+/**
+ * Return the text starting at p, up to 40 characters, to locate
+ * parse errors.
+ */
+static std::string excerpt(const char* p, const char* end)
+{
+	return std::string(p, std::min(p + 40, end));
+}
+
+HandleSeq DBLoader::load(const std::string& filename, AtomSpace& as,
+                         unsigned jobs)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw RuntimeException(TRACE_INFO, "Cannot open db file %s",
+		                       filename.c_str());
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		throw RuntimeException(TRACE_INFO, "Cannot read db file %s",
+		                       filename.c_str());
+	}
+	size_t size = st.st_size;
+	if (size == 0) {
+		close(fd);
+		return HandleSeq();
+	}
+
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		throw RuntimeException(TRACE_INFO, "Cannot map db file %s",
+		                       filename.c_str());
+
+	const char* begin = static_cast<const char*>(data);
+	HandleSeq db;
+	try {
+		db = parse(begin, begin + size, as, jobs);
+	} catch (...) {
+		munmap(data, size);
+		throw;
+	}
+	munmap(data, size);
+
+	LAZY_MINER_LOG_INFO << "Loaded " << db.size()
+	                    << " data trees from " << filename;
+	return db;
+}
+
+HandleSeq DBLoader::load_db(const std::string& filename,
+                            const Handle& db_cpt,
+                            AtomSpace& as,
+                            unsigned jobs)
+{
+	HandleSeq db = load(filename, as, jobs);
+	MinerUtils::set_db(db_cpt, db);
+	return db;
+}
+
+HandleSeq DBLoader::parse(const char* begin, const char* end,
+                          AtomSpace& as, unsigned jobs)
+{
+	std::vector<Range> ranges = split(begin, end);
+
+	// Group top-level expressions into more chunks than jobs, so that
+	// threads remain busy till the end, each thread picking up the
+	// next chunk to parse till there is none left.
+	jobs = std::max(1U, std::min(jobs, (unsigned)ranges.size()));
+	size_t n_chunks = std::min(ranges.size(), (size_t)jobs * 16);
+	std::vector<HandleSeq> chunks(n_chunks);
+	std::atomic<size_t> next(0);
+	std::exception_ptr error;
+	std::mutex error_mtx;
+	auto worker = [&]() {
+		try {
+			for (size_t c = next++; c < n_chunks; c = next++) {
+				size_t first = c * ranges.size() / n_chunks,
+					last = (c + 1) * ranges.size() / n_chunks;
+				chunks[c].reserve(last - first);
+				for (size_t i = first; i < last; i++) {
+					const char* p = ranges[i].first;
+					TruthValuePtr tv;
+					Handle dt = parse_expr(p, ranges[i].second, as, tv);
+					if (not dt)
+						throw RuntimeException(TRACE_INFO,
+							"Expected an atom, got a truth value: %s",
+							excerpt(ranges[i].first, end).c_str());
+					chunks[c].push_back(dt);
+				}
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(error_mtx);
+			error = std::current_exception();
+			next = n_chunks;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned j = 1; j < jobs; j++)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
+
+	HandleSeq db;
+	db.reserve(ranges.size());
+	for (HandleSeq& chunk : chunks)
+		db.insert(db.end(), chunk.begin(), chunk.end());
+	return db;
+}
+
+std::vector<DBLoader::Range> DBLoader::split(const char* begin,
+                                             const char* end)
+{
+	std::vector<Range> ranges;
+	const char* p = begin;
+	skip_spaces(p, end);
+	while (p < end) {
+		if (*p != '(')
+			throw RuntimeException(TRACE_INFO, "Expected (, got: %s",
+			                       excerpt(p, end).c_str());
+
+		// Find the matching parenthesis, skipping strings and
+		// comments, which may run up to the end
+		const char* start = p;
+		int depth = 0;
+		for (; p < end; p++) {
+			if (*p == '"') {
+				for (p++; p < end and *p != '"'; p++)
+					if (*p == '\\' and p + 1 < end)
+						p++;
+				if (p >= end)
+					break;
+			} else if (*p == ';') {
+				while (p < end and *p != '\n')
+					p++;
+				if (p >= end)
+					break;
+			} else if (*p == '(') {
+				depth++;
+			} else if (*p == ')' and --depth == 0) {
+				break;
+			}
+		}
+		if (p >= end)
+			throw RuntimeException(TRACE_INFO, "Unbalanced parentheses: %s",
+			                       excerpt(start, end).c_str());
+		ranges.emplace_back(start, ++p);
+		skip_spaces(p, end);
+	}
+	return ranges;
+}
+
+Handle DBLoader::parse_expr(const char*& p, const char* end,
+                            AtomSpace& as, TruthValuePtr& tv)
+{
+	const char* start = p;
+	skip_spaces(p, end);
+	if (p >= end or *p != '(')
+		throw RuntimeException(TRACE_INFO, "Expected (, got: %s",
+		                       excerpt(start, end).c_str());
+	p++;
+	skip_spaces(p, end);
+	std::string head = parse_token(p, end);
+
+	// Truth value
+	if (head == "stv") {
+		skip_spaces(p, end);
+		std::string strength = parse_token(p, end);
+		skip_spaces(p, end);
+		std::string confidence = parse_token(p, end);
+		skip_spaces(p, end);
+		if (p >= end or *p != ')')
+			throw RuntimeException(TRACE_INFO, "Invalid truth value: %s",
+			                       excerpt(start, end).c_str());
+		p++;
+		try {
+			tv = createSimpleTruthValue(std::stod(strength),
+			                            std::stod(confidence));
+		} catch (const std::logic_error&) {
+			throw RuntimeException(TRACE_INFO, "Invalid truth value: %s",
+			                       excerpt(start, end).c_str());
+		}
+		return Handle::UNDEFINED;
+	}
+
+	Type t = get_type(head);
+	if (t == NOTYPE)
+		throw RuntimeException(TRACE_INFO, "Unknown type %s: %s",
+		                       head.c_str(), excerpt(start, end).c_str());
+
+	// Node name or link outgoing, followed or preceded by an optional
+	// truth value
+	bool is_node = nameserver().isNode(t);
+	std::string name;
+	HandleSeq outgoing;
+	TruthValuePtr atom_tv;
+	skip_spaces(p, end);
+	if (is_node) {
+		name = parse_name(p, end);
+		skip_spaces(p, end);
+	}
+	while (p < end and *p != ')') {
+		TruthValuePtr child_tv;
+		Handle child = parse_expr(p, end, as, child_tv);
+		if (child_tv)
+			atom_tv = child_tv;
+		else if (is_node)
+			throw RuntimeException(TRACE_INFO, "Node with outgoing: %s",
+			                       excerpt(start, end).c_str());
+		else
+			outgoing.push_back(child);
+		skip_spaces(p, end);
+	}
+	if (p >= end)
+		throw RuntimeException(TRACE_INFO, "Unbalanced parentheses: %s",
+		                       excerpt(start, end).c_str());
+	p++;
+
+	Handle h = is_node ? as.add_node(t, std::move(name))
+		: as.add_link(t, std::move(outgoing));
+	if (atom_tv)
+		h->setTruthValue(atom_tv);
+	return h;
+}
+
+std::string DBLoader::parse_name(const char*& p, const char* end)
+{
+	if (p >= end or *p != '"')
+		return parse_token(p, end);
+
+	std::string name;
+	for (p++; p < end and *p != '"'; p++) {
+		if (*p == '\\' and p + 1 < end)
+			p++;
+		name += *p;
+	}
+	if (p >= end)
+		throw RuntimeException(TRACE_INFO, "Unterminated string: %s",
+		                       name.c_str());
+	p++;
+	return name;
+}
+
+std::string DBLoader::parse_token(const char*& p, const char* end)
+{
+	const char* start = p;
+	while (p < end and not std::isspace((unsigned char)*p)
+	       and *p != '(' and *p != ')' and *p != ';')
+		p++;
+	return std::string(start, p);
+}
+
+void DBLoader::skip_spaces(const char*& p, const char* end)
+{
+	while (p < end) {
+		if (std::isspace((unsigned char)*p))
+			p++;
+		else if (*p == ';')
+			while (p < end and *p != '\n')
+				p++;
+		else
+			break;
+	}
+}
+
+Type DBLoader::get_type(const std::string& name)
+{
+	Type t = nameserver().getType(name);
+	if (t == NOTYPE)
+		t = nameserver().getType(name + "Node");
+	if (t == NOTYPE)
+		t = nameserver().getType(name + "Link");
+	return t;
+}
+
+} // ~namespace opencog
@@ -0,0 +1,123 @@
+/*
+ * DBLoader.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_DBLOADER_H_
+#define OPENCOG_DBLOADER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atoms/truthvalue/TruthValue.h>
+#include <opencog/atomspace/AtomSpace.h>
+
+namespace opencog
+{
+
+/**
+ * Bulk loader of data trees, parsing a file of Atomese s-expressions,
+ * such as
+ *
+ * (Inheritance (stv 1 1)
+ *   (Concept "A")
+ *   (Concept "B"))
+ *
+ * straight into an atomspace, each top-level expression being a data
+ * tree. Type names can be given in full (InheritanceLink) or short
+ * (Inheritance) form, node names are strings (or numbers for
+ * NumberNode), and simple truth values (stv) are supported. Comments
+ * start with ; and run till the end of the line. Anything else, such
+ * as Scheme code, is rejected.
+ *
+ * The file is memory mapped and split at the boundaries of top-level
+ * expressions into chunks that are parsed in parallel, each atom
+ * being directly added to the atomspace, thus interned.
+ *
+ * A db concept can then be associated to the loaded data trees (see
+ * MinerUtils::set_db), instead of having a MemberLink per data tree.
+ */
+class DBLoader
+{
+public:
+	/**
+	 * Parse filename, using jobs threads, and return the data trees
+	 * it contains, in order. Throw a RuntimeException if the file
+	 * cannot be read or parsed.
+	 */
+	static HandleSeq load(const std::string& filename, AtomSpace& as,
+	                      unsigned jobs=1);
+
+	/**
+	 * Like load, and associate the data trees to db_cpt.
+	 */
+	static HandleSeq load_db(const std::string& filename,
+	                         const Handle& db_cpt,
+	                         AtomSpace& as,
+	                         unsigned jobs=1);
+
+	/**
+	 * Like load, but parse the given text instead of a file.
+	 */
+	static HandleSeq parse(const char* begin, const char* end,
+	                       AtomSpace& as, unsigned jobs=1);
+
+private:
+	typedef std::pair<const char*, const char*> Range;
+
+	/**
+	 * Return the ranges of the top-level expressions of the text.
+	 */
+	static std::vector<Range> split(const char* begin, const char* end);
+
+	/**
+	 * Parse an expression starting at p, and move p past it. Return
+	 * the atom it defines, or Handle::UNDEFINED if it is a truth
+	 * value, in which case tv is set.
+	 */
+	static Handle parse_expr(const char*& p, const char* end,
+	                         AtomSpace& as, TruthValuePtr& tv);
+
+	/**
+	 * Parse a node name, that is a string or a number, starting at p,
+	 * and move p past it.
+	 */
+	static std::string parse_name(const char*& p, const char* end);
+
+	/**
+	 * Parse a token, ended by a space or a parenthesis, starting at
+	 * p, and move p past it.
+	 */
+	static std::string parse_token(const char*& p, const char* end);
+
+	/**
+	 * Move p past spaces and comments.
+	 */
+	static void skip_spaces(const char*& p, const char* end);
+
+	/**
+	 * Return the type of the given name, full or short.
+	 */
+	static Type get_type(const std::string& name);
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_DBLOADER_H_ */
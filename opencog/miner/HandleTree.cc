@@ -25,38 +25,146 @@
 
 #include <opencog/util/Logger.h>
 #include <opencog/util/dorepeat.h>
+#include <opencog/atoms/base/Atom.h>
 
+#include <algorithm>
 #include <sstream>
+#include <unordered_map>
 
 namespace opencog {
 
-bool content_eq(const HandleTree& htl, const HandleTree& htr)
+ContentHandleSet::ContentHandleSet() : _size(0) {}
+
+ContentHandleSet::ContentHandleSet(const HandleTree& ht) : _size(0)
+{
+	for (const Handle& h : ht)
+		insert(h);
+}
+
+bool ContentHandleSet::insert(const Handle& h)
 {
-	// Make sure forests are equal
-	HandleTree::iterator itl = htl.begin(), itr = htr.begin();
-	while (htl.is_valid(itl) and htr.is_valid(itr)) {
-		if (not content_eq(itl, itr))
+	HandleSeq& same_hash = _index[h->get_hash()];
+	for (const Handle& oh : same_hash)
+		if (content_eq(h, oh))
 			return false;
-		itl = htl.next_sibling(itl);
-		itr = htr.next_sibling(itr);
+	same_hash.push_back(h);
+	_size++;
+	return true;
+}
+
+bool ContentHandleSet::erase(const Handle& h)
+{
+	auto it = _index.find(h->get_hash());
+	if (it == _index.end())
+		return false;
+	HandleSeq& same_hash = it->second;
+	for (auto hit = same_hash.begin(); hit != same_hash.end(); ++hit) {
+		if (content_eq(h, *hit)) {
+			same_hash.erase(hit);
+			if (same_hash.empty())
+				_index.erase(it);
+			_size--;
+			return true;
+		}
 	}
-	return htl.is_valid(itl) == htr.is_valid(itr);
+	return false;
 }
 
-bool content_eq(HandleTree::iterator itl, HandleTree::iterator itr)
+bool ContentHandleSet::contains(const Handle& h) const
+{
+	return (bool)find(h);
+}
+
+Handle ContentHandleSet::find(const Handle& h) const
+{
+	auto it = _index.find(h->get_hash());
+	if (it != _index.end())
+		for (const Handle& oh : it->second)
+			if (content_eq(h, oh))
+				return oh;
+	return Handle::UNDEFINED;
+}
+
+size_t ContentHandleSet::size() const
+{
+	return _size;
+}
+
+bool ContentHandleSet::empty() const
 {
-	HandleTree::sibling_iterator sibl = itl.begin(), sibr = itr.begin();
-	for (; sibl != itl.end() and sibr != itr.end(); ++sibl, ++sibr)
-		if (not content_eq(sibl, sibr))
+	return _size == 0;
+}
+
+void ContentHandleSet::clear()
+{
+	_index.clear();
+	_size = 0;
+}
+
+/**
+ * Return true iff the given sibling subtrees are content equal up to
+ * their order. Right subtrees are indexed by the content hash of
+ * their roots, so that each left subtree is only compared to the
+ * right ones with the same hash.
+ */
+static bool content_eq(const std::vector<HandleTree::iterator>& itls,
+                       const std::vector<HandleTree::iterator>& itrs)
+{
+	if (itls.size() != itrs.size())
+		return false;
+
+	std::unordered_map<ContentHash, std::vector<HandleTree::iterator>> index;
+	for (HandleTree::iterator itr : itrs)
+		index[(*itr)->get_hash()].push_back(itr);
+
+	// Content equality being an equivalence, any matching right
+	// subtree can be consumed.
+	for (HandleTree::iterator itl : itls) {
+		auto it = index.find((*itl)->get_hash());
+		if (it == index.end())
 			return false;
-	return (sibl == itl.end()) == (sibr == itr.end());
+		std::vector<HandleTree::iterator>& same_hash = it->second;
+		auto match = std::find_if(same_hash.begin(), same_hash.end(),
+		                          [&](HandleTree::iterator itr) {
+			                          return content_eq(itl, itr); });
+		if (match == same_hash.end())
+			return false;
+		same_hash.erase(match);
+	}
+	return true;
+}
+
+bool content_eq(const HandleTree& htl, const HandleTree& htr)
+{
+	std::vector<HandleTree::iterator> itls, itrs;
+	for (HandleTree::iterator itl = htl.begin(); htl.is_valid(itl);
+	     itl = htl.next_sibling(itl))
+		itls.push_back(itl);
+	for (HandleTree::iterator itr = htr.begin(); htr.is_valid(itr);
+	     itr = htr.next_sibling(itr))
+		itrs.push_back(itr);
+	return content_eq(itls, itrs);
+}
+
+bool content_eq(HandleTree::iterator itl, HandleTree::iterator itr)
+{
+	if (not content_eq(*itl, *itr))
+		return false;
+
+	std::vector<HandleTree::iterator> itls, itrs;
+	for (HandleTree::sibling_iterator sibl = itl.begin(); sibl != itl.end(); ++sibl)
+		itls.push_back(sibl);
+	for (HandleTree::sibling_iterator sibr = itr.begin(); sibr != itr.end(); ++sibr)
+		itrs.push_back(sibr);
+	return content_eq(itls, itrs);
 }
 
 bool content_contains(const HandleTree& ht, const Handle& h)
 {
-	// TODO: optimize
+	// Only compare the content of handles with the same hash
+	ContentHash hash = h->get_hash();
 	for (const Handle& oh : ht)
-		if (content_eq(h, oh))
+		if (oh->get_hash() == hash and content_eq(h, oh))
 			return true;
 	return false;
 }
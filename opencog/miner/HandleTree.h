@@ -24,6 +24,8 @@
 #ifndef OPENCOG_HANDLETREE_H_
 #define OPENCOG_HANDLETREE_H_
 
+#include <unordered_map>
+
 #include <opencog/util/empty_string.h>
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/util/tree.h>
@@ -34,8 +36,66 @@ typedef tree<Handle> HandleTree;
 typedef tree<HandleMap> HandleMapTree;
 typedef std::map<Handle, HandleTree> HandleHandleTreeMap;
 
+/**
+ * Set of handles compared by content rather than by address, indexed
+ * by content hash, so that membership is checked in constant expected
+ * time. Use it instead of content_contains for repeated membership
+ * checks over a collection of patterns.
+ */
+class ContentHandleSet
+{
+public:
+	ContentHandleSet();
+
+	/**
+	 * Build the set of all handles of a tree.
+	 */
+	explicit ContentHandleSet(const HandleTree& ht);
+
+	/**
+	 * Insert h, unless a handle with the same content is already
+	 * there. Return true iff h has been inserted.
+	 */
+	bool insert(const Handle& h);
+
+	/**
+	 * Remove the handle with the same content as h, if any. Return
+	 * true iff one has been removed.
+	 */
+	bool erase(const Handle& h);
+
+	/**
+	 * Return true iff a handle with the same content as h is there.
+	 */
+	bool contains(const Handle& h) const;
+
+	/**
+	 * Return the handle with the same content as h, or
+	 * Handle::UNDEFINED if none.
+	 */
+	Handle find(const Handle& h) const;
+
+	size_t size() const;
+	bool empty() const;
+	void clear();
+
+private:
+	std::unordered_map<ContentHash, HandleSeq> _index;
+	size_t _size;
+};
+
+/**
+ * Return true iff the given forests (resp. subtrees) are equal by
+ * content, regardless of the order of siblings.
+ */
 bool content_eq(const HandleTree& htl, const HandleTree& htr);
 bool content_eq(HandleTree::iterator itl, HandleTree::iterator itr);
+
+/**
+ * Return true iff ht contains a handle with the same content as h.
+ * Linear in the size of ht, for repeated checks build a
+ * ContentHandleSet instead.
+ */
 bool content_contains(const HandleTree& ht, const Handle& h);
 
 /**
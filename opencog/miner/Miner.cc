@@ -33,7 +33,11 @@
 #include <boost/range/numeric.hpp>
 #include <boost/range/algorithm/transform.hpp>
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
 
 namespace opencog
 {
@@ -42,9 +46,14 @@ namespace opencog
 // 7. make sure that filtering is still meaningfull
 
 MinerParameters::MinerParameters(unsigned ms, unsigned iconjuncts,
-                                 const Handle& ipat, int maxd)
+                                 const Handle& ipat, int maxd,
+                                 SearchStrategy strat, int maxn, int maxf,
+                                 double maxt, double maxm, int k,
+                                 OutputMode out)
 	: minsup(ms), initconjuncts(iconjuncts), initpat(ipat),
-	  maxdepth(maxd)
+	  maxdepth(maxd), strategy(strat), maxnodes(maxn), maxfrontier(maxf),
+	  maxtime(maxt), maxmem(maxm), topk(k), output(out),
+	  progress_interval(-1)
 {
 	// Provide initial pattern if none
 	if (not initpat) {
@@ -71,7 +80,8 @@ MinerParameters::MinerParameters(unsigned ms, unsigned iconjuncts,
 }
 
 Miner::Miner(const MinerParameters& prm)
-	: param(prm)
+	: param(prm), pattern_sink(nullptr), stopped(false),
+	  pattern_lattice(nullptr)
 {
 	tmp_as = createAtomSpace(); // Hmm Not used anywhere ...
 }
@@ -85,13 +95,103 @@ HandleTree Miner::operator()(const AtomSpace& db_as)
 
 HandleTree Miner::operator()(const HandleSeq& db)
 {
-	return specialize(param.initpat, db, param.maxdepth);
+	budget = MinerBudget(param.maxtime, param.maxmem);
+	budget.start();
+	progress_monitor.start(param.progress_interval, param.progress_callback);
+	stopped = false;
+	emitted.clear();
+	negative_border.clear();
+	closures.clear();
+	topk = TopKPatterns(std::max(param.topk, 0));
+	bool exhaustive_dfs = param.strategy == SearchStrategy::DepthFirst
+		and param.maxnodes < 0 and param.maxfrontier < 0;
+	HandleTree patterns = exhaustive_dfs ?
+		specialize(param.initpat, db, param.maxdepth) : search(db);
+	negative_border.clear();
+	emitted.clear();
+	progress_monitor.finish();
+
+	// In top-k mode, only return the top k patterns
+	if (0 <= param.topk and not pattern_sink and not pattern_lattice) {
+		patterns.clear();
+		for (const Handle& pattern : topk.patterns())
+			patterns.insert(patterns.end(), pattern);
+	}
+	topk.clear();
+	return patterns;
+}
+
+bool Miner::operator()(const AtomSpace& db_as, const PatternSink& sink)
+{
+	HandleSeq db;
+	db_as.get_handles_by_type(db, opencog::ATOM, true);
+	return operator()(db, sink);
+}
+
+bool Miner::operator()(const HandleSeq& db, const PatternSink& sink)
+{
+	pattern_sink = &sink;
+	operator()(db);
+	pattern_sink = nullptr;
+	return not stopped;
+}
+
+PatternLattice Miner::mine_lattice(const AtomSpace& db_as)
+{
+	HandleSeq db;
+	db_as.get_handles_by_type(db, opencog::ATOM, true);
+	return mine_lattice(db);
+}
+
+PatternLattice Miner::mine_lattice(const HandleSeq& db)
+{
+	PatternLattice lattice;
+	pattern_lattice = &lattice;
+	lattice_parents.clear();
+	operator()(db);
+	pattern_lattice = nullptr;
+	return lattice;
+}
+
+bool Miner::is_truncated() const
+{
+	return budget.is_exhausted() or progress_monitor.is_stopped();
+}
+
+MinerProgress Miner::progress() const
+{
+	return progress_monitor.progress();
+}
+
+bool Miner::explore(const Handle& pattern, unsigned depth, size_t frontier)
+{
+	if (not progress_monitor.explored(pattern, depth, frontier))
+		stopped = true;
+	return not stopped;
+}
+
+unsigned Miner::effective_minsup() const
+{
+	return topk.minsup(param.minsup);
+}
+
+bool Miner::emit(const Handle& pattern, const HandleSeq& db)
+{
+	if (pattern_sink and not stopped and emitted.insert(pattern)) {
+		unsigned sup = exact_support(pattern, db);
+		stopped = not (*pattern_sink)(pattern, sup);
+	}
+	return not stopped;
 }
 
 HandleTree Miner::specialize(const Handle& pattern,
                              const HandleSeq& db,
                              int maxdepth)
 {
+	// Report progress, and stop if asked to
+	if (not explore(pattern, std::max(0, param.maxdepth - maxdepth)))
+		return HandleTree();
+
 	// TODO: decide what to choose and remove or comment
 	// return specialize_alt(pattern, db, Valuations(pattern, db), maxdepth);
 	return specialize(pattern, db, Valuations(pattern, db), maxdepth);
@@ -123,6 +223,156 @@ HandleTree Miner::specialize(const Handle& pattern,
 	return patterns;
 }
 
+HandleTree Miner::search(const HandleSeq& db)
+{
+	HandleTree patterns;
+	if (param.initpat->get_type() != LAMBDA_LINK or
+	    not MinerUtils::enough_support(param.initpat, db, param.minsup))
+		return patterns;
+
+	// Patterns produced so far, to produce each pattern only once
+	ContentHandleSet produced;
+
+	// If only closed or maximal patterns are output, patterns are
+	// passed to the sink once specialized, or once it is known they
+	// will not be, in which case they are considered closed and
+	// maximal.
+	bool filtered = param.output != OutputMode::All;
+	auto unspecialized = [&](const SearchNode& node) {
+		if (filtered and pattern_sink and node.pattern != param.initpat)
+			emit(node.pattern, db);
+	};
+
+	// Frontier of patterns to specialize, ordered by rank. Patterns
+	// of equal rank are specialized in order of insertion.
+	std::multimap<double, SearchNode> frontier;
+	unsigned n_inserted = 0;
+	auto insert = [&](const SearchNode& node) {
+		frontier.emplace(search_rank(node, db, n_inserted++), node);
+		if (0 <= param.maxfrontier and
+		    (size_t)param.maxfrontier < frontier.size()) {
+			unspecialized(std::prev(frontier.end())->second);
+			frontier.erase(std::prev(frontier.end()));
+		}
+	};
+
+	insert({param.initpat, 0, HandleTree::iterator(), PatternLattice::no_node});
+	for (int n_nodes = 0;
+	     not stopped and not budget.exhausted() and
+	       not frontier.empty() and (param.maxnodes < 0 or n_nodes < param.maxnodes);
+	     n_nodes++) {
+		SearchNode node = frontier.begin()->second;
+		frontier.erase(frontier.begin());
+
+		// We have reached the maximum depth
+		if (0 <= param.maxdepth and param.maxdepth <= node.depth) {
+			unspecialized(node);
+			continue;
+		}
+
+		// Report progress, and stop if asked to
+		if (not explore(node.pattern, node.depth, frontier.size()))
+			break;
+
+		bool is_initpat = node.pattern == param.initpat;
+		Closure closure = is_initpat ? Closure{0, true, true}
+			: mk_closure(node.pattern, db);
+		for (const Handle& npat : specializations(node.pattern, db)) {
+			if (not is_initpat)
+				add_specialization(closure, npat, db);
+
+			// Link npat to its parent in the lattice, if any, and only
+			// insert it in the frontier the first time it is produced.
+			if (pattern_lattice) {
+				auto id_new = pattern_lattice->insert(npat);
+				pattern_lattice->add_edge(node.id, id_new.first);
+				if (id_new.second)
+					insert({npat, node.depth + 1, HandleTree::iterator(),
+					        id_new.first});
+				continue;
+			}
+			if (not produced.insert(npat))
+				continue;
+
+			// Pass npat to the sink, if any, instead of keeping it in
+			// the tree
+			HandleTree::iterator nit;
+			if (pattern_sink) {
+				if (not filtered and not emit(npat, db))
+					break;
+			} else {
+				nit = patterns.is_valid(node.it) ?
+					patterns.append_child(node.it, npat) :
+					patterns.insert(patterns.end(), npat);
+			}
+			insert({npat, node.depth + 1, nit, PatternLattice::no_node});
+		}
+
+		// Now that all specializations of node are known, output it,
+		// or remove it from the tree and move its children up.
+		if (filtered and not is_initpat and not stopped and not pattern_lattice) {
+			if (is_output(closure)) {
+				if (pattern_sink)
+					emit(node.pattern, db);
+			} else if (not pattern_sink) {
+				patterns.flatten(node.it);
+				patterns.erase(node.it);
+			}
+		}
+	}
+
+	// Patterns left in the frontier are not specialized
+	if (not stopped)
+		for (const auto& rank_node : frontier)
+			unspecialized(rank_node.second);
+
+	return patterns;
+}
+
+double Miner::search_rank(const SearchNode& node,
+                          const HandleSeq& db,
+                          unsigned n) const
+{
+	switch (param.strategy) {
+	case SearchStrategy::DepthFirst:
+		// Last inserted, first specialized
+		return -(double)n;
+	case SearchStrategy::BreadthFirst:
+		return node.depth;
+	case SearchStrategy::BestFirst:
+		if (param.priority)
+			return -param.priority(node.pattern, db);
+		// Memoized, thus shared with top-k and the output
+		return -(double)exact_support(node.pattern, db);
+	default:
+		OC_ASSERT(false, "Unknown search strategy");
+		return 0.0;
+	}
+}
+
+HandleSeq Miner::specializations(const Handle& pattern,
+                                 const HandleSeq& db)
+{
+	HandleSeq npats;
+	if (pattern->get_type() != LAMBDA_LINK)
+		return npats;
+
+	// No type and glob support for cpp-miner
+	Valuations valuations(pattern, db);
+	for (; not valuations.no_focus(); valuations.inc_focus_variable()) {
+		Handle var = valuations.focus_variable();
+		HandleSet shapats = MinerUtils::focus_shallow_abstract(valuations,
+		                                                       effective_minsup(),
+		                                                       false, false);
+		for (const Handle& shapat : shapats) {
+			Handle npat = compose_shapat(pattern, db, var, shapat);
+			if (npat)
+				npats.push_back(npat);
+		}
+	}
+	return npats;
+}
+
 HandleTree Miner::specialize_alt(const Handle& pattern,
                                  const HandleSeq& db,
                                  const Valuations& valuations,
@@ -137,7 +387,7 @@ HandleTree Miner::specialize_alt(const Handle& pattern,
 
 	// Calculate all shallow abstractions of pattern
 	// No type support for cpp-miner.
-	HandleSetSeq shabs = MinerUtils::shallow_abstract(valuations, param.minsup, false, false, {});
+	HandleSetSeq shabs = MinerUtils::shallow_abstract(valuations, effective_minsup(), false, false, {});
 
 	// Generate all associated specializations
 	for (unsigned i = 0; i < shabs.size(); i++) {
@@ -161,6 +411,10 @@ bool Miner::terminate(const Handle& pattern,
                       int maxdepth) const
 {
 	return
+		// The sink asked to stop
+		stopped or
+		// We have run out of time or memory
+		budget.exhausted() or
 		// We have reached the maximum depth
 		maxdepth == 0 or
 		// The pattern is constant, no specialization is possible
@@ -168,7 +422,7 @@ bool Miner::terminate(const Handle& pattern,
 		// There is no more variable to specialize from
 		valuations.no_focus() or
 		// The pattern doesn't have enough support
-		not MinerUtils::enough_support(pattern, db, param.minsup);
+		not MinerUtils::enough_support(pattern, db, effective_minsup());
 }
 
 HandleTree Miner::specialize_shabs(const Handle& pattern,
@@ -180,7 +434,7 @@ HandleTree Miner::specialize_shabs(const Handle& pattern,
 	// valuations and associate the remaining valuations (excluding
 	// that variable) to them.
 	// No type and glob support for cpp-miner
-	HandleSet shapats = MinerUtils::focus_shallow_abstract(valuations, param.minsup, false, false);
+	HandleSet shapats = MinerUtils::focus_shallow_abstract(valuations, effective_minsup(), false, false);
 
 	// No shallow abstraction to use for specialization
 	if (shapats.empty())
@@ -193,6 +447,9 @@ HandleTree Miner::specialize_shabs(const Handle& pattern,
 	Handle var = valuations.focus_variable();
 	for (const auto& shapat : shapats)
 	{
+		if (stopped or budget.exhausted())
+			break;
+
 		// Specialize pattern by composing it with shapat, and
 		// specialize the result recursively
 		HandleTree npats
@@ -211,25 +468,136 @@ HandleTree Miner::specialize_shapat(const Handle& pattern,
                                     int maxdepth)
 {
 	// Perform the composition (that is specialize)
+	Handle npat = compose_shapat(pattern, db, var, shapat);
+	if (not npat)
+		return HandleTree();
+
+	// Link npat to the pattern it specializes in the lattice, if any,
+	// instead of keeping it in the tree, then specialize it, unless it
+	// has already been reached from another pattern.
+	if (pattern_lattice) {
+		auto id_new = pattern_lattice->insert(npat);
+		pattern_lattice->add_edge(lattice_parents.empty() ?
+		                          PatternLattice::no_node : lattice_parents.back(),
+		                          id_new.first);
+		if (id_new.second) {
+			lattice_parents.push_back(id_new.first);
+			specialize(npat, db, maxdepth - 1);
+			lattice_parents.pop_back();
+		}
+		return HandleTree();
+	}
+
+	// Pass npat to the sink, if any, instead of keeping it in the
+	// tree, then specialize it, unless it has already been reached
+	// from another pattern, thus passed and specialized then.
+	if (pattern_sink and param.output == OutputMode::All) {
+		if (not emitted.contains(npat) and emit(npat, db))
+			specialize(npat, db, maxdepth - 1);
+		return HandleTree();
+	}
+
+	// Otherwise keep track of the specializations of npat while
+	// specializing it, and notify the pattern npat specializes, so
+	// that only closed or maximal patterns are output if required.
+	if (not closures.empty())
+		add_specialization(closures.back(), npat, db);
+	closures.push_back(mk_closure(npat, db));
+
+	// Specialize npat from all variables (with new valuations)
+	HandleTree nvapats = specialize(npat, db, maxdepth - 1);
+
+	Closure closure = closures.back();
+	closures.pop_back();
+
+	if (pattern_sink) {
+		if (is_output(closure))
+			emit(npat, db);
+		return HandleTree();
+	}
 
+	// Return npat and its children, or only its children if it is
+	// not to be output
+	if (not is_output(closure))
+		return nvapats;
+	return HandleTree(npat, {nvapats});
+}
+
+Miner::Closure Miner::mk_closure(const Handle& pattern,
+                                const HandleSeq& db) const
+{
+	unsigned sup = param.output == OutputMode::Closed ?
+		exact_support(pattern, db) : 0;
+	return {sup, true, true};
+}
+
+void Miner::add_specialization(Closure& closure,
+                               const Handle& npat,
+                               const HandleSeq& db) const
+{
+	closure.maximal = false;
+
+	// Since npat cannot have more support than closure.support, only
+	// count up to it.
+	if (param.output == OutputMode::Closed and closure.closed and
+	    closure.support <= MinerUtils::support_mem(npat, db, closure.support))
+		closure.closed = false;
+}
+
+bool Miner::is_output(const Closure& closure) const
+{
+	switch (param.output) {
+	case OutputMode::All:
+		return true;
+	case OutputMode::Closed:
+		return closure.closed;
+	case OutputMode::Maximal:
+		return closure.maximal;
+	default:
+		OC_ASSERT(false, "Unknown output mode");
+		return true;
+	}
+}
+
+unsigned Miner::exact_support(const Handle& pattern,
+                              const HandleSeq& db) const
+{
+	return MinerUtils::support_mem(pattern, db,
+	                               std::numeric_limits<unsigned>::max());
+}
+
+Handle Miner::compose_shapat(const Handle& pattern,
+                             const HandleSeq& db,
+                             const Handle& var,
+                             const Handle& shapat)
+{
 	Handle npat = nameserver().isA(shapat->get_type(), VARIABLE_NODE) ?
 	              MinerUtils::compose_nocheck(pattern, {var, shapat}) :
 	              MinerUtils::compose(pattern, {{var, shapat}});
 
 	// If the specialization has too few conjuncts, dismiss it.
 	if (MinerUtils::n_conjuncts(npat) < param.initconjuncts)
-		return HandleTree();
+		return Handle::UNDEFINED;
+
+	// That specialization specializes a pattern known not to have
+	// enough support, skip it and its specializations.
+	if (negative_border.is_infrequent(npat, effective_minsup()))
+		return Handle::UNDEFINED;
 
 	// That specialization doesn't have enough support, skip it
 	// and its specializations.
-	if (not MinerUtils::enough_support(npat, db, param.minsup))
-		return HandleTree();
+	if (not MinerUtils::enough_support(npat, db, effective_minsup())) {
+		negative_border.insert(npat, effective_minsup());
+		return Handle::UNDEFINED;
+	}
 
-	// Specialize npat from all variables (with new valuations)
-	HandleTree nvapats = specialize(npat, db, maxdepth - 1);
+	// Keep track of the top k patterns, which requires their exact
+	// support
+	if (0 <= param.topk)
+		topk.insert(npat, exact_support(npat, db));
 
-	// Return npat and its children
-	return HandleTree(npat, {nvapats});
+	progress_monitor.accepted();
+	return npat;
 }
 
 } // namespace opencog
@@ -23,6 +23,9 @@
 #ifndef OPENCOG_MINER_H_
 #define OPENCOG_MINER_H_
 
+#include <functional>
+#include <vector>
+
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/atoms/core/Variables.h>
 #include <opencog/atoms/core/RewriteLink.h>
@@ -31,12 +34,48 @@
 #include "HandleTree.h"
 #include "Valuations.h"
 #include "MinerUtils.h"
+#include "NegativeBorder.h"
+#include "PatternLattice.h"
+#include "MinerBudget.h"
+#include "MinerProgress.h"
+#include "TopKPatterns.h"
 
 class MinerUTest;
 
 namespace opencog
 {
 
+/**
+ * Order in which Miner explores the specializations of the initial
+ * pattern.
+ *
+ * DepthFirst: fully specialize each pattern before moving to its
+ *             siblings.
+ *
+ * BreadthFirst: produce all specializations at a given depth before
+ *               moving to the next depth.
+ *
+ * BestFirst: always specialize the pattern of highest priority (see
+ *            MinerParameters::priority) first.
+ */
+enum class SearchStrategy { DepthFirst, BreadthFirst, BestFirst };
+
+/**
+ * Patterns output by Miner.
+ *
+ * All: all patterns reaching the minimum support.
+ *
+ * Closed: only patterns with no specialization of equal support.
+ *
+ * Maximal: only patterns with no specialization reaching the minimum
+ *          support.
+ *
+ * Specializations are the ones found during the search, and patterns
+ * not specialized, due to maxdepth, maxnodes, etc, are considered
+ * closed and maximal.
+ */
+enum class OutputMode { All, Closed, Maximal };
+
 /**
  * Parameters for Miner. The terminology is taken from
  * Frequent Subtree Mining -- An Overview, from Yun Chi et al, when
@@ -51,7 +90,14 @@ struct MinerParameters {
 	MinerParameters(unsigned minsup=1,
 	                unsigned conjuncts=1,
 	                const Handle& initpat=Handle::UNDEFINED,
-	                int maxdepth=-1);
+	                int maxdepth=-1,
+	                SearchStrategy strategy=SearchStrategy::DepthFirst,
+	                int maxnodes=-1,
+	                int maxfrontier=-1,
+	                double maxtime=-1,
+	                double maxmem=-1,
+	                int topk=-1,
+	                OutputMode output=OutputMode::All);
 
 	// TODO: change frequency by support!!!
 	// Minimum support. Mined patterns must have a frequency equal or
@@ -77,8 +123,65 @@ struct MinerParameters {
 	// depth limit. Depth is the number of specializations between the
 	// initial pattern and the produced patterns.
 	int maxdepth;
+
+	// Search strategy. Unless it is DepthFirst with no node or
+	// frontier limit, the search is carried over a frontier of
+	// patterns left to specialize, each pattern being produced only
+	// once.
+	SearchStrategy strategy;
+
+	// Maximum number of patterns to specialize, the initial pattern
+	// included. If negative, then no limit. Patterns produced but not
+	// specialized yet when the limit is reached are still returned.
+	int maxnodes;
+
+	// Maximum number of patterns in the frontier. If negative, then
+	// no limit. When the frontier is full, the patterns that would be
+	// specialized last are dropped (they are still returned but not
+	// specialized).
+	int maxfrontier;
+
+	// Priority of a pattern w.r.t. a db, used by BestFirst, the
+	// higher the sooner the pattern is specialized. If undefined, then
+	// the support of the pattern is used.
+	std::function<double(const Handle&, const HandleSeq&)> priority;
+
+	// Maximum wall-clock time of a run, in seconds, and maximum
+	// memory usage of the process, in megabytes. If negative, then no
+	// limit. Once exceeded, the patterns found so far are returned
+	// (see Miner::is_truncated).
+	double maxtime;
+	double maxmem;
+
+	// If positive or null, then only the topk patterns of highest
+	// support are returned, as a flat forest ordered by decreasing
+	// support. Once topk patterns have been found, the minimum support
+	// used for pruning is raised to the support of the worst of them
+	// plus one. If negative, then all patterns reaching minsup are
+	// returned.
+	int topk;
+
+	// Patterns to output. Patterns not to output are discarded as
+	// soon as their specializations are known, and their
+	// specializations take their places in the tree.
+	OutputMode output;
+
+	// Minimum number of seconds between progress events. If negative,
+	// then no progress is reported. Each event is logged by the miner
+	// logger at INFO level and passed to progress_callback, if
+	// defined. If progress_callback returns false, then mining stops
+	// and the patterns found so far are returned (see
+	// Miner::is_truncated).
+	double progress_interval;
+	ProgressCallback progress_callback;
 };
 
+/**
+ * Function receiving a mined pattern and its support, returning false
+ * to stop mining.
+ */
+typedef std::function<bool(const Handle&, unsigned)> PatternSink;
+
 /**
  * Experimental pattern miner. Mined patterns should be compatible
  * with the pattern matcher, that is if feed to the pattern matcher,
@@ -108,6 +211,45 @@ public:
 	 */
 	HandleTree operator()(const HandleSeq& db);
 
+	/**
+	 * Like above but, instead of returning a tree of patterns, pass
+	 * each pattern to sink as soon as it has been found to have
+	 * enough support, along with its exact support. Each pattern is
+	 * passed once, and no pattern is kept once passed to sink, besides
+	 * its content hash. If sink returns false,
+	 * then mining stops. In top-k mode, patterns are passed as they
+	 * are found, thus some may not end up in the top k.
+	 *
+	 * Return true iff mining has not been stopped by sink, or by
+	 * param.progress_callback.
+	 */
+	bool operator()(const AtomSpace& db_as, const PatternSink& sink);
+	bool operator()(const HandleSeq& db, const PatternSink& sink);
+
+	/**
+	 * Like above but return a lattice of patterns instead of a tree,
+	 * each pattern appearing once, linked to all the patterns it has
+	 * been obtained from. Patterns reached again from another parent
+	 * are not specialized again. param.output and param.topk are
+	 * ignored, all patterns with enough support are in the lattice.
+	 */
+	PatternLattice mine_lattice(const AtomSpace& db_as);
+	PatternLattice mine_lattice(const HandleSeq& db);
+
+	/**
+	 * Return true iff the last run has been cut off because it
+	 * exceeded param.maxtime or param.maxmem, or because
+	 * param.progress_callback asked to stop, in which case only the
+	 * patterns found until then have been returned.
+	 */
+	bool is_truncated() const;
+
+	/**
+	 * Return the progress of the current or last run. Can be called
+	 * from another thread at any time, including while a run starts.
+	 */
+	MinerProgress progress() const;
+
 	/**
 	 * Specialization. Given a pattern and a collection of data trees,
 	 * generate all specialized patterns of the given pattern.
@@ -140,10 +282,140 @@ private:
 
 	mutable AtomSpacePtr tmp_as;
 
+	// Patterns found not to have enough support during the current
+	// run, to reject their specializations without matching them.
+	NegativeBorder negative_border;
+
+	// Time and memory budget of the current run
+	mutable MinerBudget budget;
+
+	// Progress of the current run
+	MinerProgressMonitor progress_monitor;
+
+	// Top k patterns of the current run, if param.topk is positive
+	// or null
+	TopKPatterns topk;
+
+	/**
+	 * Whether a pattern is closed and maximal, given the
+	 * specializations of it found so far. support is the exact
+	 * support of the pattern, only calculated in Closed mode.
+	 */
+	struct Closure
+	{
+		unsigned support;
+		bool closed;
+		bool maximal;
+	};
+
+	// Closures of the patterns being specialized by
+	// Miner::specialize_shapat, innermost last.
+	std::vector<Closure> closures;
+
+	/**
+	 * Return the closure of a pattern with no specialization found
+	 * yet.
+	 */
+	Closure mk_closure(const Handle& pattern, const HandleSeq& db) const;
+
+	/**
+	 * Update closure given npat, a specialization of its pattern.
+	 */
+	void add_specialization(Closure& closure,
+	                        const Handle& npat,
+	                        const HandleSeq& db) const;
+
+	/**
+	 * Return true iff a pattern with the given closure is to be output
+	 * according to param.output.
+	 */
+	bool is_output(const Closure& closure) const;
+
+	/**
+	 * Return the exact support of pattern, that is not halted at any
+	 * minimum support, memoized.
+	 */
+	unsigned exact_support(const Handle& pattern, const HandleSeq& db) const;
+
+	/**
+	 * Return the minimum support of the current run, that is
+	 * param.minsup, possibly raised by topk.
+	 */
+	unsigned effective_minsup() const;
+
+	// Sink of the current run, if any, and whether it asked to stop
+	const PatternSink* pattern_sink;
+	bool stopped;
+
+	/**
+	 * Pass pattern and its exact support to the sink, if any, unless
+	 * it has already been passed during the current run, and record
+	 * whether the sink asks to stop. Return false iff mining should
+	 * stop.
+	 */
+	bool emit(const Handle& pattern, const HandleSeq& db);
+
+	// Patterns passed to the sink during the current run
+	ContentHandleSet emitted;
+
+	// Lattice of the current run, if any, and the nodes of the
+	// patterns being specialized by Miner::specialize_shapat,
+	// innermost last.
+	PatternLattice* pattern_lattice;
+	std::vector<PatternLattice::NodeId> lattice_parents;
+
+	/**
+	 * Pattern left to specialize in the frontier of Miner::search,
+	 * with its depth and its position in the resulting tree (invalid
+	 * for the initial pattern), or its node in the resulting lattice
+	 * (no_node for the initial pattern).
+	 */
+	struct SearchNode
+	{
+		Handle pattern;
+		int depth;
+		HandleTree::iterator it;
+		PatternLattice::NodeId id;
+	};
+
+	/**
+	 * Explore the specializations of the initial pattern through a
+	 * frontier ordered according to param.strategy, and limited by
+	 * param.maxnodes and param.maxfrontier. Return the same tree as
+	 * Miner::specialize would, excluding duplicates and the patterns
+	 * beyond these limits.
+	 */
+	HandleTree search(const HandleSeq& db);
+
+	/**
+	 * Return the rank of a pattern in the frontier of Miner::search,
+	 * the lower the sooner it is specialized. n is the number of
+	 * patterns inserted in the frontier so far.
+	 */
+	double search_rank(const SearchNode& node,
+	                   const HandleSeq& db,
+	                   unsigned n) const;
+
+	/**
+	 * Return all immediate specializations of the given pattern with
+	 * enough support, across all its variables.
+	 */
+	HandleSeq specializations(const Handle& pattern,
+	                          const HandleSeq& db);
+
+	/**
+	 * Record that pattern is about to be specialized, at the given
+	 * depth and with the given frontier size, possibly emitting a
+	 * progress event. Return false iff mining should stop.
+	 */
+	bool explore(const Handle& pattern, unsigned depth, size_t frontier=0);
+
 	/**
 	 * Return true iff maxdepth is null or pattern is not a lambda or
 	 * doesn't have enough support. Additionally the second one check
 	 * whether the valuation has any variable left to specialize from.
+	 * Also return true if the sink or the progress callback asked to
+	 * stop, or the budget is exhausted.
 	 */
 	bool terminate(const Handle& pattern,
 	               const HandleSeq& db,
@@ -172,6 +444,16 @@ private:
 	                             const Handle& shapat,
 	                             int maxdepth);
 
+	/**
+	 * Specialize the given pattern with the given shallow abstraction
+	 * at the given variable. Return Handle::UNDEFINED if the
+	 * specialization has too few conjuncts or not enough support.
+	 */
+	Handle compose_shapat(const Handle& pattern,
+	                      const HandleSeq& db,
+	                      const Handle& var,
+	                      const Handle& shapat);
+
 	/**
 	 * Calculate if the pattern has enough support w.r.t. to the given
 	 * db, that is whether its frequency is greater than or equal
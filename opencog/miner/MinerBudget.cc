@@ -0,0 +1,90 @@
+/*
+ * MinerBudget.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MinerBudget.h"
+#include "MinerLogger.h"
+
+#include <opencog/util/platform.h>
+
+namespace opencog
+{
+
+MinerBudget::MinerBudget(double maxtime, double maxmem)
+	: _maxtime(maxtime), _maxmem(maxmem),
+	  _start(std::chrono::steady_clock::now()), _exhausted(false) {}
+
+MinerBudget::MinerBudget(const MinerBudget& other)
+	: _maxtime(other._maxtime), _maxmem(other._maxmem),
+	  _start(other._start), _exhausted(other._exhausted.load()) {}
+
+MinerBudget& MinerBudget::operator=(const MinerBudget& other)
+{
+	_maxtime = other._maxtime;
+	_maxmem = other._maxmem;
+	_start = other._start;
+	_exhausted = other._exhausted.load();
+	return *this;
+}
+
+void MinerBudget::start()
+{
+	_start = std::chrono::steady_clock::now();
+	_exhausted = false;
+}
+
+bool MinerBudget::exhausted()
+{
+	if (_exhausted)
+		return true;
+
+	if (0 <= _maxtime) {
+		std::chrono::duration<double> elapsed =
+			std::chrono::steady_clock::now() - _start;
+		if (_maxtime < elapsed.count()) {
+			LAZY_MINER_LOG_INFO << "Time budget of " << _maxtime
+			                    << "s exhausted, stop mining";
+			_exhausted = true;
+		}
+	}
+
+	if (not _exhausted and 0 <= _maxmem) {
+		double mem = getMemUsage() / (1024.0 * 1024.0);
+		if (_maxmem < mem) {
+			LAZY_MINER_LOG_INFO << "Memory budget of " << _maxmem
+			                    << "MB exhausted, stop mining";
+			_exhausted = true;
+		}
+	}
+
+	return _exhausted;
+}
+
+bool MinerBudget::is_exhausted() const
+{
+	return _exhausted;
+}
+
+bool MinerBudget::is_unlimited() const
+{
+	return _maxtime < 0 and _maxmem < 0;
+}
+
+} // ~namespace opencog
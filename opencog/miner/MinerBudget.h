@@ -0,0 +1,85 @@
+/*
+ * MinerBudget.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_MINERBUDGET_H_
+#define OPENCOG_MINERBUDGET_H_
+
+#include <atomic>
+#include <chrono>
+
+namespace opencog
+{
+
+/**
+ * Wall-clock time and memory budget of a mining run. The miner is
+ * expected to call exhausted() at each specialization or expansion,
+ * and to stop producing patterns once it returns true, so that the
+ * patterns found so far are returned.
+ *
+ * Memory is the memory usage of the whole process, as reported by
+ * getMemUsage.
+ *
+ * Once exhausted, a budget remains exhausted until restarted. All
+ * methods but start are thread safe.
+ */
+class MinerBudget
+{
+public:
+	/**
+	 * CTor. maxtime is the maximum number of seconds since start,
+	 * maxmem the maximum memory usage in megabytes. If negative, then
+	 * no limit.
+	 */
+	MinerBudget(double maxtime=-1, double maxmem=-1);
+	MinerBudget(const MinerBudget& other);
+	MinerBudget& operator=(const MinerBudget& other);
+
+	/**
+	 * Start the clock and reset the exhausted flag.
+	 */
+	void start();
+
+	/**
+	 * Return true iff the time or memory budget has been exceeded,
+	 * now or in a previous call since start.
+	 */
+	bool exhausted();
+
+	/**
+	 * Return true iff a previous call to exhausted since start has
+	 * returned true, that is the run has been cut off.
+	 */
+	bool is_exhausted() const;
+
+	/**
+	 * Return true iff there is neither a time nor a memory limit.
+	 */
+	bool is_unlimited() const;
+
+private:
+	double _maxtime;
+	double _maxmem;
+	std::chrono::steady_clock::time_point _start;
+	std::atomic<bool> _exhausted;
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_MINERBUDGET_H_ */
@@ -0,0 +1,119 @@
+/*
+ * MinerCheckpoint.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MinerCheckpoint.h"
+#include "MinerLogger.h"
+#include "PatternLatticeFile.h"
+
+#include <cstdio>
+
+#include <opencog/util/exceptions.h>
+
+namespace opencog
+{
+
+MinerCheckpoint::MinerCheckpoint(const std::string& filename, double period)
+	: _filename(filename), _period(period),
+	  _last_save(std::chrono::steady_clock::now()),
+	  _n_snapshots(0), _last_written(0) {}
+
+void MinerCheckpoint::insert(const Handle& pattern,
+                             const HandleSeq& specializations)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		PatternLattice::NodeId parent = _lattice.insert(pattern).first;
+		for (const Handle& npat : specializations)
+			_lattice.add_edge(parent, _lattice.insert(npat).first);
+	}
+	save_if_due();
+}
+
+bool MinerCheckpoint::save_if_due()
+{
+	PatternLattice lattice;
+	uint64_t snapshot;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_period < 0)
+			return false;
+		std::chrono::duration<double> elapsed =
+			std::chrono::steady_clock::now() - _last_save;
+		if (elapsed.count() < _period)
+			return false;
+		// Consider it saved already, so that other threads do not
+		// write the same checkpoint meanwhile.
+		_last_save = std::chrono::steady_clock::now();
+		lattice = _lattice;
+		snapshot = ++_n_snapshots;
+	}
+	write(lattice, snapshot);
+	return true;
+}
+
+void MinerCheckpoint::save()
+{
+	PatternLattice lattice;
+	uint64_t snapshot;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_last_save = std::chrono::steady_clock::now();
+		lattice = _lattice;
+		snapshot = ++_n_snapshots;
+	}
+	write(lattice, snapshot);
+}
+
+size_t MinerCheckpoint::size() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _lattice.size();
+}
+
+HandleSeq MinerCheckpoint::resume(AtomSpace& as)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_lattice = PatternLatticeFile(_filename).load(as);
+	LAZY_MINER_LOG_INFO << "Resumed " << _lattice.size()
+	                    << " patterns from checkpoint " << _filename;
+	return _lattice.patterns();
+}
+
+void MinerCheckpoint::write(const PatternLattice& lattice, uint64_t snapshot)
+{
+	std::lock_guard<std::mutex> lock(_write_mutex);
+
+	// A newer snapshot has been written meanwhile, do not overwrite
+	// it with an older one.
+	if (snapshot <= _last_written)
+		return;
+
+	std::string tmp_filename = _filename + ".tmp";
+	PatternLatticeFile::save(lattice, tmp_filename);
+	if (std::rename(tmp_filename.c_str(), _filename.c_str()) != 0)
+		throw RuntimeException(TRACE_INFO, "Cannot write checkpoint %s",
+		                       _filename.c_str());
+	_last_written = snapshot;
+	LAZY_MINER_LOG_INFO << "Saved " << lattice.size()
+	                    << " patterns to checkpoint " << _filename;
+}
+
+} // ~namespace opencog
@@ -0,0 +1,120 @@
+/*
+ * MinerCheckpoint.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_MINERCHECKPOINT_H_
+#define OPENCOG_MINERCHECKPOINT_H_
+
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atomspace/AtomSpace.h>
+
+#include "PatternLattice.h"
+
+namespace opencog
+{
+
+/**
+ * Periodic checkpoint of a mining run, so that it can be resumed if
+ * interrupted. The miner is expected to call insert each time it
+ * specializes or expands patterns, which records the patterns with
+ * enough support found so far in a lattice, and regularly writes
+ * that lattice to a pattern lattice file (see PatternLatticeFile).
+ *
+ * Since the support of each pattern is memoized as a value of it
+ * (see MinerUtils::support_mem), and saved along with it, resuming
+ * from a checkpoint restores both the patterns found and their
+ * supports, so that re-specializing them does not require to run the
+ * pattern matcher again. An exhaustive run resumed from a checkpoint
+ * thus finds the same patterns as an uninterrupted one.
+ *
+ * Files are written to a temporary file first, then renamed, so that
+ * a checkpoint is never left half written. The lattice is copied
+ * before being written, so that recording patterns is not held back
+ * by writing.
+ *
+ * All methods are thread safe.
+ */
+class MinerCheckpoint
+{
+public:
+	/**
+	 * CTor. period is the minimum number of seconds between 2
+	 * checkpoints written by save_if_due. If negative, then only
+	 * save writes checkpoints.
+	 */
+	MinerCheckpoint(const std::string& filename, double period=-1);
+
+	/**
+	 * Record pattern and its specializations with enough support, if
+	 * any, then write a checkpoint if one is due.
+	 */
+	void insert(const Handle& pattern, const HandleSeq& specializations);
+
+	/**
+	 * Write a checkpoint if period has elapsed since the last one.
+	 * Return true iff one has been written.
+	 */
+	bool save_if_due();
+
+	/**
+	 * Write a checkpoint now.
+	 */
+	void save();
+
+	/**
+	 * Return the number of recorded patterns.
+	 */
+	size_t size() const;
+
+	/**
+	 * Add the patterns of the checkpoint previously written to
+	 * filename to as, with their supports, record them, edges
+	 * included, in place of the recorded ones, and return them.
+	 */
+	HandleSeq resume(AtomSpace& as);
+
+private:
+	/**
+	 * Write lattice, the given snapshot of _lattice, to the checkpoint
+	 * file, unless a newer snapshot has already been written. Writes
+	 * are serialized by _write_mutex rather than _mutex.
+	 */
+	void write(const PatternLattice& lattice, uint64_t snapshot);
+
+	std::string _filename;
+	double _period;
+	std::chrono::steady_clock::time_point _last_save;
+	PatternLattice _lattice;
+	mutable std::mutex _mutex;
+
+	// Number of snapshots of _lattice taken so far, under _mutex, and
+	// number of the last snapshot written, under _write_mutex.
+	uint64_t _n_snapshots;
+	uint64_t _last_written;
+	std::mutex _write_mutex;
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_MINERCHECKPOINT_H_ */
@@ -0,0 +1,213 @@
+/*
+ * MinerProgress.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MinerProgress.h"
+#include "MinerLogger.h"
+#include "MinerStats.h"
+#include "MinerUtils.h"
+
+#include <iomanip>
+#include <sstream>
+
+#include <opencog/util/platform.h>
+
+namespace opencog
+{
+
+double MinerProgress::hit_rate() const
+{
+	uint64_t total = cache_hits + cache_misses;
+	return 0 < total ? (double)cache_hits / total : -1.0;
+}
+
+std::string MinerProgress::to_string() const
+{
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1)
+	   << "elapsed " << elapsed << "s"
+	   << ", explored " << explored
+	   << " (" << throughput << "/s, recent " << recent_throughput << "/s)"
+	   << ", accepted " << accepted
+	   << ", depth " << depth
+	   << ", conjuncts " << conjuncts
+	   << ", frontier " << frontier
+	   << ", cache hit rate ";
+	if (0 <= hit_rate())
+		ss << 100 * hit_rate() << "%";
+	else
+		ss << "n/a";
+	ss << ", memory " << memory << "MB";
+	return ss.str();
+}
+
+MinerProgressMonitor::MinerProgressMonitor(double interval,
+                                           const ProgressCallback& callback)
+	: _interval(interval), _callback(callback),
+	  _start(std::chrono::steady_clock::now().time_since_epoch().count()),
+	  _explored(0), _accepted(0), _depth(0), _conjuncts(0), _frontier(0),
+	  _stopped(false), _last_elapsed(0), _last_explored(0),
+	  _next(interval) {}
+
+MinerProgressMonitor::MinerProgressMonitor(const MinerProgressMonitor& other)
+	: _interval(other._interval.load()), _callback(other._callback),
+	  _start(other._start.load()),
+	  _explored(other._explored.load()), _accepted(other._accepted.load()),
+	  _depth(other._depth.load()), _conjuncts(other._conjuncts.load()),
+	  _frontier(other._frontier.load()), _stopped(other._stopped.load()),
+	  _last_elapsed(other._last_elapsed.load()),
+	  _last_explored(other._last_explored.load()),
+	  _next(other._next.load()) {}
+
+MinerProgressMonitor&
+MinerProgressMonitor::operator=(const MinerProgressMonitor& other)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_interval = other._interval.load();
+	_callback = other._callback;
+	_start = other._start.load();
+	_explored = other._explored.load();
+	_accepted = other._accepted.load();
+	_depth = other._depth.load();
+	_conjuncts = other._conjuncts.load();
+	_frontier = other._frontier.load();
+	_stopped = other._stopped.load();
+	_last_elapsed = other._last_elapsed.load();
+	_last_explored = other._last_explored.load();
+	_next = other._next.load();
+	return *this;
+}
+
+void MinerProgressMonitor::start()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	start_nolock();
+}
+
+void MinerProgressMonitor::start(double interval,
+                                 const ProgressCallback& callback)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_interval = interval;
+	_callback = callback;
+	start_nolock();
+}
+
+void MinerProgressMonitor::start_nolock()
+{
+	_start = std::chrono::steady_clock::now().time_since_epoch().count();
+	_explored = 0;
+	_accepted = 0;
+	_depth = 0;
+	_conjuncts = 0;
+	_frontier = 0;
+	_stopped = false;
+	_last_elapsed = 0;
+	_last_explored = 0;
+	_next = _interval.load();
+}
+
+bool MinerProgressMonitor::explored(const Handle& pattern, unsigned depth,
+                                    size_t frontier)
+{
+	_explored.fetch_add(1, std::memory_order_relaxed);
+	_depth.store(depth, std::memory_order_relaxed);
+	_conjuncts.store(MinerUtils::n_conjuncts(pattern),
+	                 std::memory_order_relaxed);
+	_frontier.store(frontier, std::memory_order_relaxed);
+
+	if (not is_enabled() or seconds() < _next.load(std::memory_order_relaxed))
+		return not is_stopped();
+
+	// Another thread may be emitting that event already
+	std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+	if (lock.owns_lock() and _next <= seconds()) {
+		MinerProgress p = progress();
+		_next = p.elapsed + _interval.load();
+		emit(p);
+	}
+	return not is_stopped();
+}
+
+void MinerProgressMonitor::accepted(uint64_t n)
+{
+	_accepted.fetch_add(n, std::memory_order_relaxed);
+}
+
+void MinerProgressMonitor::finish()
+{
+	if (not is_enabled())
+		return;
+	std::lock_guard<std::mutex> lock(_mutex);
+	emit(progress());
+}
+
+MinerProgress MinerProgressMonitor::progress() const
+{
+	MinerProgress p;
+	p.elapsed = seconds();
+	p.explored = _explored.load(std::memory_order_relaxed);
+	p.accepted = _accepted.load(std::memory_order_relaxed);
+	p.depth = _depth.load(std::memory_order_relaxed);
+	p.conjuncts = _conjuncts.load(std::memory_order_relaxed);
+	p.frontier = _frontier.load(std::memory_order_relaxed);
+	p.throughput = 0 < p.elapsed ? p.explored / p.elapsed : 0.0;
+	double dt = p.elapsed - _last_elapsed;
+	p.recent_throughput = 0 < dt ? (p.explored - _last_explored) / dt
+		: p.throughput;
+	p.cache_hits = MinerStats::hits(MinerStats::SupportMem)
+		+ MinerStats::hits(MinerStats::ValuesMem);
+	p.cache_misses = MinerStats::misses(MinerStats::SupportMem)
+		+ MinerStats::misses(MinerStats::ValuesMem);
+	p.memory = getMemUsage() / (1024.0 * 1024.0);
+	return p;
+}
+
+bool MinerProgressMonitor::is_stopped() const
+{
+	return _stopped.load(std::memory_order_relaxed);
+}
+
+bool MinerProgressMonitor::is_enabled() const
+{
+	return 0 <= _interval.load(std::memory_order_relaxed);
+}
+
+void MinerProgressMonitor::emit(const MinerProgress& progress)
+{
+	LAZY_MINER_LOG_INFO << "Mining progress: " << progress.to_string();
+	if (_callback and not is_stopped() and not _callback(progress)) {
+		LAZY_MINER_LOG_INFO << "Progress callback asked to stop mining";
+		_stopped = true;
+	}
+	_last_elapsed = progress.elapsed;
+	_last_explored = progress.explored;
+}
+
+double MinerProgressMonitor::seconds() const
+{
+	std::chrono::steady_clock::duration
+		start_time(_start.load(std::memory_order_relaxed));
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now().time_since_epoch() - start_time;
+	return elapsed.count();
+}
+
+} // ~namespace opencog
@@ -0,0 +1,200 @@
+/*
+ * MinerProgress.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_MINERPROGRESS_H_
+#define OPENCOG_MINERPROGRESS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <opencog/atoms/base/Handle.h>
+
+namespace opencog
+{
+
+/**
+ * Snapshot of the progress of a mining run.
+ */
+struct MinerProgress
+{
+	// Number of seconds since the start of the run
+	double elapsed;
+
+	// Number of patterns explored, that is considered for
+	// specialization, and number of specializations accepted, that is
+	// produced with enough support.
+	uint64_t explored;
+	uint64_t accepted;
+
+	// Depth (number of specializations from the initial pattern) and
+	// number of conjuncts of the last explored pattern, and number of
+	// patterns left to explore in the frontier of the search. The
+	// frontier is 0 when unknown, i.e. in exhaustive depth first
+	// search, and so is the depth when mining with the rule engine.
+	unsigned depth;
+	unsigned conjuncts;
+	size_t frontier;
+
+	// Explored patterns per second since the start of the run, and
+	// since the previous progress event.
+	double throughput;
+	double recent_throughput;
+
+	// Hits and misses of the support and valuations caches (see
+	// MinerUtils::support_mem and MinerUtils::values_mem). Only
+	// counted while MinerStats is enabled.
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+
+	// Memory usage of the process in megabytes
+	double memory;
+
+	/**
+	 * Return the ratio of cache hits, or a negative value if the
+	 * caches have not been used, or MinerStats is disabled.
+	 */
+	double hit_rate() const;
+
+	std::string to_string() const;
+};
+
+/**
+ * Function receiving a progress event, returning false to stop mining.
+ */
+typedef std::function<bool(const MinerProgress&)> ProgressCallback;
+
+/**
+ * Monitor of the progress of a mining run, emitting a progress event
+ * every interval seconds, that is logging it through the miner logger
+ * at INFO level and passing it to a callback, if any.
+ *
+ * The miner is expected to call explored for each pattern it is
+ * about to specialize, which may emit an event, and accepted for each
+ * specialization it produces. Events are thus only emitted between
+ * pattern evaluations, so that a long period without events
+ * indicates a stalled evaluation.
+ *
+ * All methods are thread safe, so that progress may be polled from
+ * another thread at any time, including while a run is started.
+ */
+class MinerProgressMonitor
+{
+public:
+	/**
+	 * CTor. If interval is negative, then no event is emitted, but
+	 * progress is still counted (see progress).
+	 */
+	MinerProgressMonitor(double interval=-1,
+	                     const ProgressCallback& callback=ProgressCallback());
+	MinerProgressMonitor(const MinerProgressMonitor& other);
+	MinerProgressMonitor& operator=(const MinerProgressMonitor& other);
+
+	/**
+	 * Start the clock and reset all counts.
+	 */
+	void start();
+
+	/**
+	 * Like above, but also set the interval and the callback, in
+	 * place of the ones given at construction.
+	 */
+	void start(double interval, const ProgressCallback& callback);
+
+	/**
+	 * Record that pattern is about to be specialized, at the given
+	 * depth and with the given number of patterns left in the
+	 * frontier, and emit an event if the interval has elapsed since
+	 * the previous one. Return false iff the callback has asked to
+	 * stop, now or in a previous event since start.
+	 */
+	bool explored(const Handle& pattern, unsigned depth=0,
+	              size_t frontier=0);
+
+	/**
+	 * Record n accepted specializations.
+	 */
+	void accepted(uint64_t n=1);
+
+	/**
+	 * Emit an event now, if enabled, regardless of the interval. To be
+	 * called at the end of a run.
+	 */
+	void finish();
+
+	/**
+	 * Return the progress of the current run.
+	 */
+	MinerProgress progress() const;
+
+	/**
+	 * Return true iff the callback has asked to stop.
+	 */
+	bool is_stopped() const;
+
+	/**
+	 * Return true iff events are emitted.
+	 */
+	bool is_enabled() const;
+
+private:
+	/**
+	 * Log progress and pass it to the callback, if any.
+	 */
+	void emit(const MinerProgress& progress);
+
+	/**
+	 * Like start, assuming the lock is taken.
+	 */
+	void start_nolock();
+
+	double seconds() const;
+
+	// Interval and start time, as a count of steady clock ticks, are
+	// read without lock when counting progress. The callback is only
+	// accessed under the lock.
+	std::atomic<double> _interval;
+	ProgressCallback _callback;
+	std::atomic<std::chrono::steady_clock::rep> _start;
+
+	std::atomic<uint64_t> _explored;
+	std::atomic<uint64_t> _accepted;
+	std::atomic<unsigned> _depth;
+	std::atomic<unsigned> _conjuncts;
+	std::atomic<size_t> _frontier;
+	std::atomic<bool> _stopped;
+
+	// Time and number of explored patterns of the previous event,
+	// and time of the next one
+	std::atomic<double> _last_elapsed;
+	std::atomic<uint64_t> _last_explored;
+	std::atomic<double> _next;
+
+	// Emitting events and starting are serialized, other threads skip
+	// the events being emitted
+	mutable std::mutex _mutex;
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_MINERPROGRESS_H_ */
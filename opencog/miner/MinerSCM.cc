@@ -24,14 +24,30 @@
 #ifdef HAVE_GUILE
 
 #include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 
 #include <opencog/util/Logger.h>
 #include <opencog/guile/SchemeModule.h>
 #include <opencog/atoms/core/NumberNode.h>
+#include <opencog/atoms/truthvalue/SimpleTruthValue.h>
 
 #include "MinerUtils.h"
 #include "Surprisingness.h"
 #include "MinerLogger.h"
+#include "NegativeBorder.h"
+#include "MinerBudget.h"
+#include "TopKPatterns.h"
+#include "PatternLattice.h"
+#include "PatternLatticeFile.h"
+#include "MinerCheckpoint.h"
+#include "DBLoader.h"
+#include "SyntheticKB.h"
+#include "MinerStats.h"
+#include "MinerTrace.h"
+#include "MinerProgress.h"
 
 namespace opencog {
 
@@ -119,6 +135,35 @@ protected:
 	double do_isurp(Handle pattern, Handle db, Handle db_ratio);
 	double do_nisurp(Handle pattern, Handle db, Handle db_ratio);
 
+	/**
+	 * Calculate the I-Surprisingness of a list of patterns with
+	 * respect to db, in a single batch (see
+	 * Surprisingness::isurp_batch), using the given number of jobs.
+	 *
+	 * Return a List of surprisingness evaluations, one per pattern, in
+	 * the same order, such as
+	 *
+	 * Evaluation (stv <isurp> 1)
+	 *   Predicate "isurp"
+	 *   List
+	 *     <pattern>
+	 *     <db>
+	 *
+	 * do_isurp_batch: I-Surprisingness
+	 * do_nisurp_batch: normalized I-Surprisingness
+	 */
+	Handle do_isurp_batch(Handle patterns, Handle db,
+	                      Handle db_ratio, Handle jobs);
+	Handle do_nisurp_batch(Handle patterns, Handle db,
+	                       Handle db_ratio, Handle jobs);
+
+	/**
+	 * Helper for do_isurp_batch and do_nisurp_batch
+	 */
+	Handle isurp_batch(const std::string& mode, bool normalize,
+	                   Handle patterns, Handle db,
+	                   Handle db_ratio, Handle jobs);
+
 	/**
 	 * Calculate the empirical truth value of pattern
 	 */
@@ -139,6 +184,301 @@ protected:
 	 */
 	Logger* do_miner_logger();
 
+	/**
+	 * Clear the negative border associated to db (see
+	 * negative_border). To be called once mining over db is
+	 * over. Return true.
+	 */
+	bool do_clear_negative_border(Handle db);
+
+	/**
+	 * Clear the memos shared by surprisingness calculations (see
+	 * Surprisingness::clear_values_mem and
+	 * Surprisingness::clear_abstraction_mem). To be called once the
+	 * surprisingness of the mined patterns has been calculated.
+	 * Return true.
+	 */
+	bool do_clear_surprisingness_mem();
+
+	/**
+	 * Return the negative border associated to db, shared by all
+	 * calls of cog-shallow-specialize and cog-expand-conjunction over
+	 * db, so that specializations of patterns known to be infrequent
+	 * are rejected without being matched.
+	 */
+	NegativeBorder& negative_border(const Handle& db);
+
+	std::map<Handle, NegativeBorder> _negative_borders;
+	std::mutex _negative_borders_mutex;
+
+	/**
+	 * Start a time and memory budget for mining db, maxtime in
+	 * seconds and maxmem in megabytes, negative meaning no limit. Once
+	 * the budget is exhausted, cog-shallow-specialize and
+	 * cog-expand-conjunction over db return empty sets, so that the
+	 * rule engine stops producing patterns. Return true.
+	 */
+	bool do_start_miner_budget(Handle db, Handle maxtime, Handle maxmem);
+
+	/**
+	 * Return true iff the budget associated to db has been exhausted,
+	 * that is the mining over db has been cut off.
+	 */
+	bool do_miner_budget_exhausted(Handle db);
+
+	/**
+	 * Remove the budget associated to db. To be called once mining
+	 * over db is over. Return true.
+	 */
+	bool do_clear_miner_budget(Handle db);
+
+	/**
+	 * Return true iff db has a budget and it is exhausted.
+	 */
+	bool budget_exhausted(const Handle& db);
+
+	std::map<Handle, MinerBudget> _budgets;
+	std::mutex _budgets_mutex;
+
+	/**
+	 * Start keeping track of the k patterns of highest support mined
+	 * over db. Until cleared, cog-shallow-specialize and
+	 * cog-expand-conjunction over db record the patterns they produce
+	 * and, once k patterns are recorded, raise their minimum support
+	 * to the support of the worst of them plus one (see
+	 * TopKPatterns). Return true.
+	 */
+	bool do_start_miner_topk(Handle db, Handle k);
+
+	/**
+	 * Return a List of the top k patterns mined over db so far, by
+	 * decreasing support.
+	 */
+	Handle do_miner_topk(Handle db);
+
+	/**
+	 * Stop keeping track of the top k patterns mined over db. Return
+	 * true.
+	 */
+	bool do_clear_miner_topk(Handle db);
+
+	/**
+	 * Return the top k patterns associated to db, or nullptr if none.
+	 * They are shared so that they remain valid if cleared
+	 * concurrently.
+	 */
+	std::shared_ptr<TopKPatterns> topk(const Handle& db);
+
+	/**
+	 * Return ms, possibly raised by the top k patterns associated to
+	 * db, if any.
+	 */
+	unsigned effective_minsup(const Handle& db, unsigned ms);
+
+	/**
+	 * Record patterns in the top k patterns associated to db, if any.
+	 */
+	void insert_topk(const Handle& db, const HandleSeq& db_seq,
+	                 const HandleSeq& patterns);
+
+	std::map<Handle, std::shared_ptr<TopKPatterns>> _topks;
+	std::mutex _topks_mutex;
+
+	/**
+	 * Start recording, for each pattern specialized by
+	 * cog-shallow-specialize or cog-expand-conjunction (with enforced
+	 * specialization) over db, whether it has a specialization of
+	 * equal support (thus is not closed), or any specialization (thus
+	 * is not maximal). Return true.
+	 */
+	bool do_start_miner_closure(Handle db);
+
+	/**
+	 * Given a List of patterns mined over db, return a List of the
+	 * closed (resp. maximal) ones, according to what has been recorded
+	 * since cog-start-miner-closure.
+	 */
+	Handle do_closed_patterns(Handle patterns, Handle db);
+	Handle do_maximal_patterns(Handle patterns, Handle db);
+
+	/**
+	 * Stop recording closure information over db. Return true.
+	 */
+	bool do_clear_miner_closure(Handle db);
+
+	/**
+	 * Patterns known not to be closed, or not to be maximal.
+	 */
+	struct PatternClosures
+	{
+		HandleSet non_closed;
+		HandleSet non_maximal;
+		std::mutex mutex;
+	};
+
+	/**
+	 * Return the pattern closures associated to db, or nullptr if
+	 * none.
+	 */
+	std::shared_ptr<PatternClosures> closures(const Handle& db);
+
+	/**
+	 * Record that pattern has been specialized into specializations,
+	 * if closure information is recorded over db.
+	 */
+	void record_specializations(const Handle& db, const HandleSeq& db_seq,
+	                            const Handle& pattern,
+	                            const HandleSeq& specializations);
+
+	/**
+	 * Helper for do_closed_patterns and do_maximal_patterns
+	 */
+	Handle filter_patterns(Handle patterns, Handle db, bool maximal);
+
+	std::map<Handle, std::shared_ptr<PatternClosures>> _closures;
+	std::mutex _closures_mutex;
+
+	/**
+	 * Start checkpointing the patterns mined over db to filename,
+	 * writing a checkpoint at most every period seconds (see
+	 * MinerCheckpoint). Until cleared, cog-shallow-specialize and
+	 * cog-expand-conjunction over db record the patterns they take
+	 * and produce. Return true.
+	 */
+	bool do_start_miner_checkpoint(Handle db, const std::string& filename,
+	                               Handle period);
+
+	/**
+	 * Write the checkpoint of db now, if any. Return true.
+	 */
+	bool do_save_miner_checkpoint(Handle db);
+
+	/**
+	 * Stop checkpointing the patterns mined over db. Return true.
+	 */
+	bool do_clear_miner_checkpoint(Handle db);
+
+	/**
+	 * Load the patterns of the checkpoint of db, previously written,
+	 * into the current atomspace, with their supports, and return a
+	 * List of them (see MinerCheckpoint::resume). The checkpoint
+	 * must have been started.
+	 */
+	Handle do_resume_miner_checkpoint(Handle db);
+
+	/**
+	 * Return the checkpoint of db, or nullptr if none.
+	 */
+	std::shared_ptr<MinerCheckpoint> checkpoint(const Handle& db);
+
+	/**
+	 * Record pattern and its specializations in the checkpoint of db,
+	 * if any.
+	 */
+	void record_checkpoint(const Handle& db, const Handle& pattern,
+	                       const HandleSeq& specializations);
+
+	std::map<Handle, std::shared_ptr<MinerCheckpoint>> _checkpoints;
+	std::mutex _checkpoints_mutex;
+
+	/**
+	 * Reset the hot path statistics of the miner and start recording
+	 * them (see MinerStats).
+	 */
+	bool do_start_miner_stats();
+
+	/**
+	 * Stop recording the hot path statistics, keeping the ones
+	 * recorded so far.
+	 */
+	bool do_stop_miner_stats();
+
+	/**
+	 * Return the hot path statistics recorded so far, as a table.
+	 */
+	std::string do_miner_stats();
+
+	/**
+	 * Start tracing the cost of each pattern evaluation to filename
+	 * (see MinerTrace).
+	 */
+	bool do_start_miner_trace(const std::string& filename);
+
+	/**
+	 * Stop tracing and close the trace file.
+	 */
+	bool do_stop_miner_trace();
+
+	/**
+	 * Start reporting the progress of mining db, logging a progress
+	 * event at most every interval seconds (see MinerProgress), each
+	 * call of cog-shallow-specialize and cog-expand-conjunction over
+	 * db counting as an explored pattern. Return true.
+	 */
+	bool do_start_miner_progress(Handle db, Handle interval);
+
+	/**
+	 * Return the progress of mining db so far, as a string, or the
+	 * empty string if its progress is not reported.
+	 */
+	std::string do_miner_progress(Handle db);
+
+	/**
+	 * Log the final progress of mining db and stop reporting it.
+	 * Return true.
+	 */
+	bool do_clear_miner_progress(Handle db);
+
+	/**
+	 * Return the progress monitor of db, or nullptr if none.
+	 */
+	std::shared_ptr<MinerProgressMonitor> progress_monitor(const Handle& db);
+
+	std::map<Handle, std::shared_ptr<MinerProgressMonitor>> _progress_monitors;
+	std::mutex _progress_monitors_mutex;
+
+	/**
+	 * Load the data trees of filename, a file of Atomese
+	 * s-expressions, in the current atomspace, using the given number
+	 * of jobs, and associate them to db (see DBLoader). Return db.
+	 */
+	Handle do_load_db(const std::string& filename, Handle db, Handle jobs);
+
+	/**
+	 * Generate a synthetic knowledge base in the current atomspace
+	 * (see SyntheticKB), associate its data trees to db, and return
+	 * the planted patterns in a List.
+	 */
+	Handle do_add_synthetic_kb(Handle db, Handle data_trees, Handle nodes,
+	                           Handle zipf, Handle depth, Handle planted,
+	                           Handle seed);
+
+	/**
+	 * Save patterns to filename as a pattern lattice file (see
+	 * PatternLatticeFile), along with their support and truth
+	 * values. patterns is a List of patterns, or of surprisingness
+	 * evaluations
+	 *
+	 * Evaluation
+	 *   Predicate "mode"
+	 *   List
+	 *     pattern
+	 *     db
+	 *
+	 * in which case the strength of each evaluation is saved as the
+	 * surprisingness of its pattern. Since the patterns are not
+	 * linked by specialization relationships, the saved lattice has
+	 * no edges. Return true.
+	 */
+	bool do_save_pattern_lattice(const std::string& filename, Handle patterns);
+
+	/**
+	 * Load all patterns of a pattern lattice file into the current
+	 * atomspace, along with their support, truth values and
+	 * surprisingness, and return a List of them.
+	 */
+	Handle do_load_pattern_lattice(const std::string& filename);
+
 public:
 	MinerSCM();
 };
@@ -182,6 +522,12 @@ void MinerSCM::init(void)
 	define_scheme_primitive("cog-nisurp",
 		&MinerSCM::do_nisurp, this, "miner");
 
+	define_scheme_primitive("cog-isurp-batch",
+		&MinerSCM::do_isurp_batch, this, "miner");
+
+	define_scheme_primitive("cog-nisurp-batch",
+		&MinerSCM::do_nisurp_batch, this, "miner");
+
 	define_scheme_primitive("cog-emp-tv",
 		&MinerSCM::do_emp_tv, this, "miner");
 
@@ -193,6 +539,90 @@ void MinerSCM::init(void)
 
 	define_scheme_primitive("cog-miner-logger",
 		&MinerSCM::do_miner_logger, this, "miner");
+
+	define_scheme_primitive("cog-clear-negative-border",
+		&MinerSCM::do_clear_negative_border, this, "miner");
+
+	define_scheme_primitive("cog-clear-surprisingness-mem",
+		&MinerSCM::do_clear_surprisingness_mem, this, "miner");
+
+	define_scheme_primitive("cog-start-miner-budget",
+		&MinerSCM::do_start_miner_budget, this, "miner");
+
+	define_scheme_primitive("cog-miner-budget-exhausted?",
+		&MinerSCM::do_miner_budget_exhausted, this, "miner");
+
+	define_scheme_primitive("cog-clear-miner-budget",
+		&MinerSCM::do_clear_miner_budget, this, "miner");
+
+	define_scheme_primitive("cog-start-miner-topk",
+		&MinerSCM::do_start_miner_topk, this, "miner");
+
+	define_scheme_primitive("cog-miner-topk",
+		&MinerSCM::do_miner_topk, this, "miner");
+
+	define_scheme_primitive("cog-clear-miner-topk",
+		&MinerSCM::do_clear_miner_topk, this, "miner");
+
+	define_scheme_primitive("cog-start-miner-closure",
+		&MinerSCM::do_start_miner_closure, this, "miner");
+
+	define_scheme_primitive("cog-closed-patterns",
+		&MinerSCM::do_closed_patterns, this, "miner");
+
+	define_scheme_primitive("cog-maximal-patterns",
+		&MinerSCM::do_maximal_patterns, this, "miner");
+
+	define_scheme_primitive("cog-clear-miner-closure",
+		&MinerSCM::do_clear_miner_closure, this, "miner");
+
+	define_scheme_primitive("cog-start-miner-checkpoint",
+		&MinerSCM::do_start_miner_checkpoint, this, "miner");
+
+	define_scheme_primitive("cog-save-miner-checkpoint",
+		&MinerSCM::do_save_miner_checkpoint, this, "miner");
+
+	define_scheme_primitive("cog-clear-miner-checkpoint",
+		&MinerSCM::do_clear_miner_checkpoint, this, "miner");
+
+	define_scheme_primitive("cog-resume-miner-checkpoint",
+		&MinerSCM::do_resume_miner_checkpoint, this, "miner");
+
+	define_scheme_primitive("cog-start-miner-stats",
+		&MinerSCM::do_start_miner_stats, this, "miner");
+
+	define_scheme_primitive("cog-stop-miner-stats",
+		&MinerSCM::do_stop_miner_stats, this, "miner");
+
+	define_scheme_primitive("cog-miner-stats",
+		&MinerSCM::do_miner_stats, this, "miner");
+
+	define_scheme_primitive("cog-start-miner-trace",
+		&MinerSCM::do_start_miner_trace, this, "miner");
+
+	define_scheme_primitive("cog-stop-miner-trace",
+		&MinerSCM::do_stop_miner_trace, this, "miner");
+
+	define_scheme_primitive("cog-start-miner-progress",
+		&MinerSCM::do_start_miner_progress, this, "miner");
+
+	define_scheme_primitive("cog-miner-progress",
+		&MinerSCM::do_miner_progress, this, "miner");
+
+	define_scheme_primitive("cog-clear-miner-progress",
+		&MinerSCM::do_clear_miner_progress, this, "miner");
+
+	define_scheme_primitive("cog-load-db",
+		&MinerSCM::do_load_db, this, "miner");
+
+	define_scheme_primitive("cog-add-synthetic-kb",
+		&MinerSCM::do_add_synthetic_kb, this, "miner");
+
+	define_scheme_primitive("cog-save-pattern-lattice",
+		&MinerSCM::do_save_pattern_lattice, this, "miner");
+
+	define_scheme_primitive("cog-load-pattern-lattice",
+		&MinerSCM::do_load_pattern_lattice, this, "miner");
 }
 
 Handle MinerSCM::do_shallow_abstract(Handle pattern,
@@ -241,11 +671,20 @@ Handle MinerSCM::do_shallow_specialize(Handle pattern,
 {
 	AtomSpacePtr asp = SchemeSmob::ss_get_env_as("cog-shallow-specialize");
 
+	// Out of time or memory, do not specialize any further
+	if (budget_exhausted(db))
+		return asp->add_link(SET_LINK, HandleSeq());
+
+	// Report progress, if enabled
+	std::shared_ptr<MinerProgressMonitor> progress = progress_monitor(db);
+	if (progress)
+		progress->explored(pattern);
+
 	// Fetch data trees
 	HandleSeq db_seq = MinerUtils::get_db(db);
 
 	// Get minimum support and maximum number of variables
-	unsigned ms = MinerUtils::get_uint(ms_h);
+	unsigned ms = effective_minsup(db, MinerUtils::get_uint(ms_h));
 	unsigned mv = MinerUtils::get_uint(mv_h);
 
 	// Generate all shallow specializations
@@ -253,9 +692,16 @@ Handle MinerSCM::do_shallow_specialize(Handle pattern,
 			MinerUtils::shallow_specialize(pattern, db_seq, ms, mv,
 					enable_type->getTruthValue()->get_mean() > 0,
 					enable_glob->getTruthValue()->get_mean() > 0,
-					ignore_vars->getOutgoingSet());
-
-	return asp->add_link(SET_LINK, HandleSeq(shaspes.begin(), shaspes.end()));
+					ignore_vars->getOutgoingSet(),
+					&negative_border(db));
+
+	Handle results = asp->add_link(SET_LINK, HandleSeq(shaspes.begin(), shaspes.end()));
+	if (progress)
+		progress->accepted(results->get_arity());
+	insert_topk(db, db_seq, results->getOutgoingSet());
+	record_specializations(db, db_seq, pattern, results->getOutgoingSet());
+	record_checkpoint(db, pattern, results->getOutgoingSet());
+	return results;
 }
 
 bool MinerSCM::do_enough_support(Handle pattern, Handle db, Handle ms_h)
@@ -275,16 +721,37 @@ Handle MinerSCM::do_expand_conjunction(Handle cnjtion, Handle pattern,
 {
 	AtomSpacePtr asp = SchemeSmob::ss_get_env_as("cog-expand-conjunction");
 
+	// Out of time or memory, do not expand any further
+	if (budget_exhausted(db))
+		return asp->add_link(SET_LINK, HandleSeq());
+
+	// Report progress, if enabled
+	std::shared_ptr<MinerProgressMonitor> progress = progress_monitor(db);
+	if (progress)
+		progress->explored(cnjtion);
+
 	// Fetch data trees
 	HandleSeq db_seq = MinerUtils::get_db(db);
 
 	// Get minimum support and maximum variables
-	unsigned ms = MinerUtils::get_uint(ms_h);
+	unsigned ms = effective_minsup(db, MinerUtils::get_uint(ms_h));
 	unsigned mv = MinerUtils::get_uint(mv_h);
 
 	HandleSet results = MinerUtils::expand_conjunction(cnjtion, pattern,
-	                                                   db_seq, ms, mv, es);
-	return asp->add_link(SET_LINK, HandleSeq(results.begin(), results.end()));
+	                                                   db_seq, ms, mv, es,
+	                                                   &negative_border(db));
+	Handle results_set = asp->add_link(SET_LINK, HandleSeq(results.begin(), results.end()));
+	if (progress)
+		progress->accepted(results_set->get_arity());
+	insert_topk(db, db_seq, results_set->getOutgoingSet());
+	// Expansions are only guaranteed to specialize cnjtion if
+	// specialization is enforced
+	if (es)
+		record_specializations(db, db_seq, cnjtion,
+		                       results_set->getOutgoingSet());
+	record_checkpoint(db, cnjtion, results_set->getOutgoingSet());
+	record_checkpoint(db, pattern, {});
+	return results_set;
 }
 
 double MinerSCM::do_isurp_old(Handle pattern, Handle db, Handle /*db_ratio*/)
@@ -321,6 +788,45 @@ double MinerSCM::do_nisurp(Handle pattern, Handle db, Handle db_ratio)
 	return Surprisingness::isurp(pattern, db_seq, true, db_rat);
 }
 
+Handle MinerSCM::do_isurp_batch(Handle patterns, Handle db,
+                                Handle db_ratio, Handle jobs)
+{
+	return isurp_batch("isurp", false, patterns, db, db_ratio, jobs);
+}
+
+Handle MinerSCM::do_nisurp_batch(Handle patterns, Handle db,
+                                 Handle db_ratio, Handle jobs)
+{
+	return isurp_batch("nisurp", true, patterns, db, db_ratio, jobs);
+}
+
+Handle MinerSCM::isurp_batch(const std::string& mode, bool normalize,
+                             Handle patterns, Handle db,
+                             Handle db_ratio, Handle jobs)
+{
+	AtomSpacePtr asp = SchemeSmob::ss_get_env_as("cog-isurp-batch");
+
+	// Fetch arguments, db is only fetched once for the whole batch
+	const HandleSeq& pats = patterns->getOutgoingSet();
+	HandleSeq db_seq = MinerUtils::get_db(db);
+	double db_rat = MinerUtils::get_double(db_ratio);
+	unsigned jb = MinerUtils::get_uint(jobs);
+
+	std::vector<double> isurps =
+		Surprisingness::isurp_batch(pats, db_seq, normalize, db_rat, jb);
+
+	// Build the surprisingness evaluations
+	Handle pred = asp->add_node(PREDICATE_NODE, std::string(mode));
+	HandleSeq evals;
+	for (size_t i = 0; i < pats.size(); i++) {
+		Handle eval = asp->add_link(EVALUATION_LINK, pred,
+		                            asp->add_link(LIST_LINK, pats[i], db));
+		eval->setTruthValue(createSimpleTruthValue(isurps[i], 1.0));
+		evals.push_back(eval);
+	}
+	return asp->add_link(LIST_LINK, std::move(evals));
+}
+
 TruthValuePtr MinerSCM::do_emp_tv(Handle pattern, Handle db, Handle db_ratio)
 {
 	// Fetch arguments
@@ -350,6 +856,352 @@ Logger* MinerSCM::do_miner_logger()
 	return &miner_logger();
 }
 
+bool MinerSCM::do_clear_negative_border(Handle db)
+{
+	std::lock_guard<std::mutex> lock(_negative_borders_mutex);
+	_negative_borders.erase(db);
+	return true;
+}
+
+bool MinerSCM::do_clear_surprisingness_mem()
+{
+	Surprisingness::clear_values_mem();
+	Surprisingness::clear_abstraction_mem();
+	return true;
+}
+
+NegativeBorder& MinerSCM::negative_border(const Handle& db)
+{
+	std::lock_guard<std::mutex> lock(_negative_borders_mutex);
+	return _negative_borders[db];
+}
+
+bool MinerSCM::do_start_miner_budget(Handle db, Handle maxtime, Handle maxmem)
+{
+	MinerBudget budget(MinerUtils::get_double(maxtime),
+	                   MinerUtils::get_double(maxmem));
+	budget.start();
+	std::lock_guard<std::mutex> lock(_budgets_mutex);
+	_budgets[db] = budget;
+	return true;
+}
+
+bool MinerSCM::do_miner_budget_exhausted(Handle db)
+{
+	std::lock_guard<std::mutex> lock(_budgets_mutex);
+	auto it = _budgets.find(db);
+	return it != _budgets.end() and it->second.is_exhausted();
+}
+
+bool MinerSCM::do_clear_miner_budget(Handle db)
+{
+	std::lock_guard<std::mutex> lock(_budgets_mutex);
+	_budgets.erase(db);
+	return true;
+}
+
+bool MinerSCM::budget_exhausted(const Handle& db)
+{
+	std::lock_guard<std::mutex> lock(_budgets_mutex);
+	auto it = _budgets.find(db);
+	return it != _budgets.end() and it->second.exhausted();
+}
+
+bool MinerSCM::do_start_miner_topk(Handle db, Handle k)
+{
+	std::lock_guard<std::mutex> lock(_topks_mutex);
+	_topks[db] = std::make_shared<TopKPatterns>(MinerUtils::get_uint(k));
+	return true;
+}
+
+Handle MinerSCM::do_miner_topk(Handle db)
+{
+	AtomSpacePtr asp = SchemeSmob::ss_get_env_as("cog-miner-topk");
+
+	std::shared_ptr<TopKPatterns> tk = topk(db);
+	return asp->add_link(LIST_LINK, tk ? tk->patterns() : HandleSeq());
+}
+
+bool MinerSCM::do_clear_miner_topk(Handle db)
+{
+	std::lock_guard<std::mutex> lock(_topks_mutex);
+	_topks.erase(db);
+	return true;
+}
+
+std::shared_ptr<TopKPatterns> MinerSCM::topk(const Handle& db)
+{
+	std::lock_guard<std::mutex> lock(_topks_mutex);
+	auto it = _topks.find(db);
+	return it == _topks.end() ? nullptr : it->second;
+}
+
+unsigned MinerSCM::effective_minsup(const Handle& db, unsigned ms)
+{
+	std::shared_ptr<TopKPatterns> tk = topk(db);
+	return tk ? tk->minsup(ms) : ms;
+}
+
+void MinerSCM::insert_topk(const Handle& db, const HandleSeq& db_seq,
+                           const HandleSeq& patterns)
+{
+	std::shared_ptr<TopKPatterns> tk = topk(db);
+	if (not tk)
+		return;
+
+	// The exact support is required to rank patterns
+	for (const Handle& pattern : patterns) {
+		unsigned sup = MinerUtils::support_mem(pattern, db_seq,
+		                                       std::numeric_limits<unsigned>::max());
+		tk->insert(pattern, sup);
+	}
+}
+
+bool MinerSCM::do_start_miner_closure(Handle db)
+{
+	std::lock_guard<std::mutex> lock(_closures_mutex);
+	_closures[db] = std::make_shared<PatternClosures>();
+	return true;
+}
+
+Handle MinerSCM::do_closed_patterns(Handle patterns, Handle db)
+{
+	return filter_patterns(patterns, db, false);
+}
+
+Handle MinerSCM::do_maximal_patterns(Handle patterns, Handle db)
+{
+	return filter_patterns(patterns, db, true);
+}
+
+bool MinerSCM::do_clear_miner_closure(Handle db)
+{
+	std::lock_guard<std::mutex> lock(_closures_mutex);
+	_closures.erase(db);
+	return true;
+}
+
+std::shared_ptr<MinerSCM::PatternClosures> MinerSCM::closures(const Handle& db)
+{
+	std::lock_guard<std::mutex> lock(_closures_mutex);
+	auto it = _closures.find(db);
+	return it == _closures.end() ? nullptr : it->second;
+}
+
+void MinerSCM::record_specializations(const Handle& db,
+                                      const HandleSeq& db_seq,
+                                      const Handle& pattern,
+                                      const HandleSeq& specializations)
+{
+	std::shared_ptr<PatternClosures> pcs = closures(db);
+	if (not pcs or specializations.empty())
+		return;
+
+	// Since specializations cannot have more support than pattern,
+	// only count their support up to the one of pattern.
+	unsigned sup = MinerUtils::support_mem(pattern, db_seq,
+	                                       std::numeric_limits<unsigned>::max());
+	bool closed = true;
+	for (const Handle& spec : specializations) {
+		if (sup <= MinerUtils::support_mem(spec, db_seq, sup)) {
+			closed = false;
+			break;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(pcs->mutex);
+	pcs->non_maximal.insert(pattern);
+	if (not closed)
+		pcs->non_closed.insert(pattern);
+}
+
+Handle MinerSCM::filter_patterns(Handle patterns, Handle db, bool maximal)
+{
+	AtomSpacePtr asp = SchemeSmob::ss_get_env_as(maximal ?
+	                                             "cog-maximal-patterns" :
+	                                             "cog-closed-patterns");
+
+	std::shared_ptr<PatternClosures> pcs = closures(db);
+	if (not pcs)
+		return patterns;
+
+	std::lock_guard<std::mutex> lock(pcs->mutex);
+	const HandleSet& excluded = maximal ? pcs->non_maximal : pcs->non_closed;
+	HandleSeq kept;
+	for (const Handle& pattern : patterns->getOutgoingSet())
+		if (excluded.find(pattern) == excluded.end())
+			kept.push_back(pattern);
+	return asp->add_link(LIST_LINK, std::move(kept));
+}
+
+bool MinerSCM::do_start_miner_checkpoint(Handle db,
+                                         const std::string& filename,
+                                         Handle period)
+{
+	double prd = MinerUtils::get_double(period);
+	std::lock_guard<std::mutex> lock(_checkpoints_mutex);
+	_checkpoints[db] = std::make_shared<MinerCheckpoint>(filename, prd);
+	return true;
+}
+
+bool MinerSCM::do_save_miner_checkpoint(Handle db)
+{
+	std::shared_ptr<MinerCheckpoint> mc = checkpoint(db);
+	if (mc)
+		mc->save();
+	return true;
+}
+
+bool MinerSCM::do_clear_miner_checkpoint(Handle db)
+{
+	std::lock_guard<std::mutex> lock(_checkpoints_mutex);
+	_checkpoints.erase(db);
+	return true;
+}
+
+Handle MinerSCM::do_resume_miner_checkpoint(Handle db)
+{
+	AtomSpacePtr asp = SchemeSmob::ss_get_env_as("cog-resume-miner-checkpoint");
+
+	std::shared_ptr<MinerCheckpoint> mc = checkpoint(db);
+	return asp->add_link(LIST_LINK, mc ? mc->resume(*asp) : HandleSeq());
+}
+
+std::shared_ptr<MinerCheckpoint> MinerSCM::checkpoint(const Handle& db)
+{
+	std::lock_guard<std::mutex> lock(_checkpoints_mutex);
+	auto it = _checkpoints.find(db);
+	return it == _checkpoints.end() ? nullptr : it->second;
+}
+
+void MinerSCM::record_checkpoint(const Handle& db, const Handle& pattern,
+                                 const HandleSeq& specializations)
+{
+	std::shared_ptr<MinerCheckpoint> mc = checkpoint(db);
+	if (mc)
+		mc->insert(pattern, specializations);
+}
+
+bool MinerSCM::do_start_miner_stats()
+{
+	MinerStats::reset();
+	MinerStats::enable();
+	return true;
+}
+
+bool MinerSCM::do_stop_miner_stats()
+{
+	MinerStats::enable(false);
+	return true;
+}
+
+std::string MinerSCM::do_miner_stats()
+{
+	return MinerStats::to_string();
+}
+
+bool MinerSCM::do_start_miner_trace(const std::string& filename)
+{
+	miner_trace().open(filename);
+	return true;
+}
+
+bool MinerSCM::do_stop_miner_trace()
+{
+	miner_trace().close();
+	return true;
+}
+
+bool MinerSCM::do_start_miner_progress(Handle db, Handle interval)
+{
+	auto progress = std::make_shared<MinerProgressMonitor>(
+		MinerUtils::get_double(interval));
+	progress->start();
+	std::lock_guard<std::mutex> lock(_progress_monitors_mutex);
+	_progress_monitors[db] = progress;
+	return true;
+}
+
+std::string MinerSCM::do_miner_progress(Handle db)
+{
+	std::shared_ptr<MinerProgressMonitor> progress = progress_monitor(db);
+	return progress ? progress->progress().to_string() : "";
+}
+
+bool MinerSCM::do_clear_miner_progress(Handle db)
+{
+	std::shared_ptr<MinerProgressMonitor> progress = progress_monitor(db);
+	if (progress)
+		progress->finish();
+	std::lock_guard<std::mutex> lock(_progress_monitors_mutex);
+	_progress_monitors.erase(db);
+	return true;
+}
+
+std::shared_ptr<MinerProgressMonitor>
+MinerSCM::progress_monitor(const Handle& db)
+{
+	std::lock_guard<std::mutex> lock(_progress_monitors_mutex);
+	auto it = _progress_monitors.find(db);
+	return it == _progress_monitors.end() ? nullptr : it->second;
+}
+
+Handle MinerSCM::do_load_db(const std::string& filename, Handle db,
+                            Handle jobs)
+{
+	AtomSpacePtr asp = SchemeSmob::ss_get_env_as("cog-load-db");
+
+	DBLoader::load_db(filename, db, *asp, MinerUtils::get_uint(jobs));
+	return db;
+}
+
+Handle MinerSCM::do_add_synthetic_kb(Handle db, Handle data_trees,
+                                     Handle nodes, Handle zipf,
+                                     Handle depth, Handle planted,
+                                     Handle seed)
+{
+	AtomSpacePtr asp = SchemeSmob::ss_get_env_as("cog-add-synthetic-kb");
+
+	SyntheticKB kb(SyntheticKBParameters(MinerUtils::get_uint(data_trees),
+	                                     MinerUtils::get_uint(nodes),
+	                                     MinerUtils::get_double(zipf),
+	                                     MinerUtils::get_uint(depth),
+	                                     MinerUtils::get_uint(planted),
+	                                     MinerUtils::get_uint(seed)));
+	MinerUtils::set_db(db, kb(*asp));
+	return asp->add_link(LIST_LINK, HandleSeq(kb.planted()));
+}
+
+bool MinerSCM::do_save_pattern_lattice(const std::string& filename,
+                                       Handle patterns)
+{
+	PatternLattice lattice;
+	for (const Handle& h : patterns->getOutgoingSet()) {
+		if (h->get_type() == EVALUATION_LINK) {
+			const Handle& args = h->getOutgoingAtom(1);
+			Handle pattern = args->getOutgoingAtom(0);
+			Surprisingness::set_surp(pattern, h->getTruthValue()->get_mean());
+			lattice.insert(pattern);
+		} else {
+			lattice.insert(h);
+		}
+	}
+	PatternLatticeFile::save(lattice, filename);
+	return true;
+}
+
+Handle MinerSCM::do_load_pattern_lattice(const std::string& filename)
+{
+	AtomSpacePtr asp = SchemeSmob::ss_get_env_as("cog-load-pattern-lattice");
+
+	PatternLatticeFile plf(filename);
+	HandleSeq patterns;
+	patterns.reserve(plf.size());
+	for (PatternLattice::NodeId node = 0; node < plf.size(); node++)
+		patterns.push_back(plf.pattern(node, *asp));
+	return asp->add_link(LIST_LINK, std::move(patterns));
+}
+
 extern "C" {
 void opencog_miner_init(void);
 };
@@ -0,0 +1,146 @@
+/*
+ * MinerStats.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MinerStats.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace opencog
+{
+
+std::atomic<bool> MinerStats::_enabled(false);
+MinerStats::Counters MinerStats::_counters[MinerStats::N_STATS] = {};
+
+MinerStats::Timer::Timer(Stat stat)
+	: _stat(stat), _enabled(MinerStats::enabled())
+{
+	if (_enabled)
+		_start = std::chrono::steady_clock::now();
+}
+
+MinerStats::Timer::~Timer()
+{
+	if (not _enabled)
+		return;
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - _start).count();
+	Counters& c = _counters[_stat];
+	c.calls.fetch_add(1, std::memory_order_relaxed);
+	c.ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void MinerStats::Timer::rows(uint64_t n)
+{
+	if (_enabled)
+		_counters[_stat].rows.fetch_add(n, std::memory_order_relaxed);
+}
+
+void MinerStats::enable(bool e)
+{
+	_enabled = e;
+}
+
+void MinerStats::rows(Stat stat, uint64_t n)
+{
+	if (enabled())
+		_counters[stat].rows.fetch_add(n, std::memory_order_relaxed);
+}
+
+void MinerStats::hit(Stat stat)
+{
+	if (enabled())
+		_counters[stat].hits.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MinerStats::miss(Stat stat)
+{
+	if (enabled())
+		_counters[stat].misses.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t MinerStats::hits(Stat stat)
+{
+	return _counters[stat].hits.load(std::memory_order_relaxed);
+}
+
+uint64_t MinerStats::misses(Stat stat)
+{
+	return _counters[stat].misses.load(std::memory_order_relaxed);
+}
+
+void MinerStats::reset()
+{
+	for (Counters& c : _counters) {
+		c.calls = 0;
+		c.ns = 0;
+		c.rows = 0;
+		c.hits = 0;
+		c.misses = 0;
+	}
+}
+
+std::string MinerStats::to_string()
+{
+	std::stringstream ss;
+	ss << std::left << std::setw(26) << "function"
+	   << std::right << std::setw(10) << "calls"
+	   << std::setw(12) << "total (s)"
+	   << std::setw(12) << "mean (ms)"
+	   << std::setw(12) << "rows"
+	   << std::setw(10) << "hits"
+	   << std::setw(10) << "misses" << std::endl;
+	ss << std::fixed;
+	for (int s = 0; s < N_STATS; s++) {
+		const Counters& c = _counters[s];
+		uint64_t calls = c.calls, hits = c.hits, misses = c.misses;
+		if (calls == 0 and hits == 0 and misses == 0)
+			continue;
+		double total = c.ns / 1e9;
+		ss << std::left << std::setw(26) << name((Stat)s)
+		   << std::right << std::setw(10) << calls
+		   << std::setw(12) << std::setprecision(3) << total
+		   << std::setw(12) << std::setprecision(3)
+		   << (0 < calls ? 1e3 * total / calls : 0.0)
+		   << std::setw(12) << c.rows
+		   << std::setw(10) << hits
+		   << std::setw(10) << misses << std::endl;
+	}
+	return ss.str();
+}
+
+const char* MinerStats::name(Stat stat)
+{
+	switch (stat) {
+	case RestrictedSatisfyingSet: return "restricted_satisfying_set";
+	case ValuationsConstruction: return "Valuations";
+	case FocusShallowAbstract: return "focus_shallow_abstract";
+	case ShallowSpecialize: return "shallow_specialize";
+	case ExpandConjunction: return "expand_conjunction";
+	case SupportMem: return "support_mem";
+	case ISurprisingness: return "isurp";
+	case PartitionEstimates: return "ji_prob_est_interval";
+	case ValuesMem: return "values_mem";
+	default: return "unknown";
+	}
+}
+
+} // ~namespace opencog
@@ -0,0 +1,135 @@
+/*
+ * MinerStats.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_MINERSTATS_H_
+#define OPENCOG_MINERSTATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace opencog
+{
+
+/**
+ * Counters and cumulative timers of the hot paths of the miner, to
+ * find out where the time goes during a run.
+ *
+ * For each instrumented function it records the number of calls,
+ * their total time, the number of rows processed (satisfying set
+ * size, number of produced patterns, etc) and, for memoized
+ * functions, cache hits and misses.
+ *
+ * Statistics are disabled by default, in which case instrumentation
+ * costs a relaxed atomic load per call. Counters are atomic, thus
+ * can be updated from any thread.
+ */
+class MinerStats
+{
+public:
+	enum Stat {
+		RestrictedSatisfyingSet,
+		ValuationsConstruction,
+		FocusShallowAbstract,
+		ShallowSpecialize,
+		ExpandConjunction,
+		SupportMem,
+		ISurprisingness,
+		PartitionEstimates,
+		ValuesMem,
+		N_STATS
+	};
+
+	/**
+	 * Time the scope it lives in, and record it along with one call
+	 * of stat, if enabled.
+	 */
+	class Timer
+	{
+	public:
+		Timer(Stat stat);
+		~Timer();
+
+		/**
+		 * Record n rows processed by the timed call.
+		 */
+		void rows(uint64_t n);
+
+	private:
+		Stat _stat;
+		bool _enabled;
+		std::chrono::steady_clock::time_point _start;
+	};
+
+	static bool enabled()
+	{
+		return _enabled.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Enable or disable statistics. Disabling keeps the statistics
+	 * recorded so far.
+	 */
+	static void enable(bool e=true);
+
+	/**
+	 * Record n rows, a cache hit or a cache miss of stat, if enabled.
+	 */
+	static void rows(Stat stat, uint64_t n);
+	static void hit(Stat stat);
+	static void miss(Stat stat);
+
+	/**
+	 * Return the cache hits and misses of stat recorded so far.
+	 */
+	static uint64_t hits(Stat stat);
+	static uint64_t misses(Stat stat);
+
+	/**
+	 * Reset all statistics to zero.
+	 */
+	static void reset();
+
+	/**
+	 * Return a table of the statistics, one line per instrumented
+	 * function that has been called, with its calls, total and mean
+	 * time, rows, hits and misses.
+	 */
+	static std::string to_string();
+
+private:
+	struct Counters {
+		std::atomic<uint64_t> calls;
+		std::atomic<uint64_t> ns;
+		std::atomic<uint64_t> rows;
+		std::atomic<uint64_t> hits;
+		std::atomic<uint64_t> misses;
+	};
+
+	static const char* name(Stat stat);
+
+	static std::atomic<bool> _enabled;
+	static Counters _counters[N_STATS];
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_MINERSTATS_H_ */
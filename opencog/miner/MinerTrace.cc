@@ -0,0 +1,129 @@
+/*
+ * MinerTrace.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MinerTrace.h"
+#include "MinerLogger.h"
+#include "MinerUtils.h"
+
+#include <opencog/util/exceptions.h>
+#include <opencog/util/platform.h>
+#include <opencog/atoms/base/Atom.h>
+
+namespace opencog
+{
+
+MinerTrace::Scope::Scope(const char* op, const Handle& pattern,
+                         size_t candidates)
+	: _op(op), _candidates(candidates), _rows(0),
+	  _enabled(miner_trace().is_open()), _mem(0)
+{
+	if (not _enabled)
+		return;
+	_pattern = pattern;
+	_mem = getMemUsage();
+	_start = std::chrono::steady_clock::now();
+}
+
+MinerTrace::Scope::~Scope()
+{
+	if (not _enabled)
+		return;
+	double wall_us = std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - _start).count();
+	long mem_kb = ((long)getMemUsage() - (long)_mem) / 1024;
+	miner_trace().write(_op, _pattern, wall_us, _candidates, _rows, mem_kb);
+}
+
+void MinerTrace::Scope::rows(uint64_t n)
+{
+	_rows = n;
+}
+
+MinerTrace::MinerTrace() : _open(false) {}
+
+MinerTrace::~MinerTrace()
+{
+	close();
+}
+
+void MinerTrace::open(const std::string& filename)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_file.is_open())
+		_file.close();
+	_seen.clear();
+	_file.open(filename, std::ios::trunc);
+	if (not _file)
+		throw RuntimeException(TRACE_INFO, "Cannot open trace file %s",
+		                       filename.c_str());
+	_file << "op,hash,conjuncts,wall_us,candidates,rows,mem_kb,pattern\n";
+	_open = true;
+	LAZY_MINER_LOG_INFO << "Trace pattern evaluations to " << filename;
+}
+
+void MinerTrace::close()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_open = false;
+	if (_file.is_open())
+		_file.close();
+	_seen.clear();
+}
+
+void MinerTrace::write(const char* op, const Handle& pattern, double wall_us,
+                       size_t candidates, uint64_t rows, long mem_kb)
+{
+	ContentHash hash = pattern->get_hash();
+	std::lock_guard<std::mutex> lock(_mutex);
+	// The trace may have been closed during the evaluation
+	if (not _file.is_open())
+		return;
+	_file << op << ',' << hash
+	      << ',' << MinerUtils::n_conjuncts(pattern)
+	      << ',' << (uint64_t)wall_us
+	      << ',' << candidates
+	      << ',' << rows
+	      << ',' << mem_kb << ',';
+
+	// Write the pattern the first time only, on one line and quoted
+	if (_seen.insert(hash).second) {
+		std::string str = pattern->to_short_string();
+		_file << '"';
+		for (char c : str) {
+			if (c == '\n')
+				continue;
+			if (c == '"')
+				_file << '"';
+			_file << c;
+		}
+		_file << '"';
+	}
+	_file << '\n';
+}
+
+// Create and return the single instance
+MinerTrace& miner_trace()
+{
+	static MinerTrace miner_trace_instance;
+	return miner_trace_instance;
+}
+
+} // ~namespace opencog
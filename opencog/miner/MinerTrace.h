@@ -0,0 +1,135 @@
+/*
+ * MinerTrace.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_MINERTRACE_H_
+#define OPENCOG_MINERTRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include <opencog/atoms/base/Handle.h>
+
+namespace opencog
+{
+
+/**
+ * Per-pattern cost trace, to find out which patterns are
+ * pathologically expensive. When open, each evaluation of a pattern
+ * (support, valuations, shallow specialization, I-Surprisingness)
+ * appends a row to a CSV file with columns
+ *
+ * op,hash,conjuncts,wall_us,candidates,rows,mem_kb,pattern
+ *
+ * where
+ *
+ * op is the evaluation (support, valuations, shallow_specialize,
+ *    isurp),
+ *
+ * hash is the content hash of the pattern, to group rows by pattern,
+ *
+ * wall_us is the wall time of the evaluation in microseconds,
+ *
+ * candidates is the number of data trees the pattern matcher is run
+ *    over,
+ *
+ * rows is the number of rows produced (support, valuations,
+ *    specializations, partitions),
+ *
+ * mem_kb is the growth of the memory usage of the process during the
+ *    evaluation (thus approximate if other threads allocate too),
+ *
+ * pattern is the pattern on one line, only given at the first row of
+ *    its hash to keep the trace compact.
+ *
+ * Rows can then be sorted offline, for instance with
+ *
+ * sort -t, -k4 -n -r trace.csv | head
+ *
+ * When closed, tracing costs a relaxed atomic load per evaluation.
+ * All methods are thread safe.
+ */
+class MinerTrace
+{
+public:
+	/**
+	 * Scope of an evaluation, appending its row to the trace when
+	 * destroyed, if the trace is open.
+	 */
+	class Scope
+	{
+	public:
+		Scope(const char* op, const Handle& pattern, size_t candidates);
+		~Scope();
+
+		/**
+		 * Set the number of rows produced by the evaluation.
+		 */
+		void rows(uint64_t n);
+
+	private:
+		const char* _op;
+		Handle _pattern;
+		size_t _candidates;
+		uint64_t _rows;
+		bool _enabled;
+		size_t _mem;
+		std::chrono::steady_clock::time_point _start;
+	};
+
+	MinerTrace();
+	~MinerTrace();
+
+	/**
+	 * Open filename, overwriting it, and start tracing. Throw a
+	 * RuntimeException if it cannot be opened.
+	 */
+	void open(const std::string& filename);
+
+	/**
+	 * Stop tracing and close the trace file, if open.
+	 */
+	void close();
+
+	bool is_open() const
+	{
+		return _open.load(std::memory_order_relaxed);
+	}
+
+private:
+	void write(const char* op, const Handle& pattern, double wall_us,
+	           size_t candidates, uint64_t rows, long mem_kb);
+
+	std::atomic<bool> _open;
+	std::ofstream _file;
+	std::unordered_set<ContentHash> _seen;
+	std::mutex _mutex;
+};
+
+// singleton instance (following Meyer's design pattern)
+MinerTrace& miner_trace();
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_MINERTRACE_H_ */
@@ -23,6 +23,10 @@
 
 #include "MinerUtils.h"
 #include "MinerLogger.h"
+#include "ConjunctionBuilder.h"
+#include "NegativeBorder.h"
+#include "MinerStats.h"
+#include "MinerTrace.h"
 
 #include <opencog/util/dorepeat.h>
 #include <opencog/util/random.h>
@@ -40,10 +44,16 @@
 #include <opencog/atoms/core/FindUtils.h>
 #include <opencog/atoms/core/TypeUtils.h>
 #include <opencog/atoms/core/UnorderedLink.h>
+#include <opencog/atoms/value/LinkValue.h>
 #include <opencog/atoms/pattern/PatternLink.h>
 #include <opencog/atoms/pattern/GetLink.h>
 #include <opencog/query/Satisfier.h>
 
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+
+#include <boost/functional/hash.hpp>
 #include <boost/range/algorithm/transform.hpp>
 #include <boost/range/algorithm/unique.hpp>
 #include <boost/range/algorithm/sort.hpp>
@@ -94,6 +104,8 @@ HandleSet MinerUtils::focus_shallow_abstract(const Valuations& valuations,
                                              bool enable_type,
                                              bool enable_glob)
 {
+	MinerStats::Timer timer(MinerStats::FocusShallowAbstract);
+
 	// If there are no valuations, then the result is empty by
 	// convention, regardless of the minimum support threshold.
 	if (valuations.empty())
@@ -108,6 +120,7 @@ HandleSet MinerUtils::focus_shallow_abstract(const Valuations& valuations,
 	// Strongly connected valuations associated to the variable under
 	// focus
 	const SCValuations& var_scv(valuations.focus_scvaluations());
+	timer.rows(var_scv.valuations.size());
 
 	////////////////////////////
 	// Shallow abtractions    //
@@ -225,7 +238,7 @@ HandleSet MinerUtils::focus_shallow_abstract(const Valuations& valuations,
 	// support
 	for (const auto& fvar : facvars) {
 		if (ms <= fvar.second) {
-			set_support(fvar.first, fvar.second);
+			set_support(fvar.first, fvar.second, ms);
 			shabs.insert({fvar.first, {}});
 		}
    }
@@ -431,7 +444,12 @@ Handle MinerUtils::compose_nocheck(const Handle& pattern, const HandlePair& var2
 
 HandleSeq MinerUtils::get_db(const Handle& db_cpt)
 {
-	// Retrieve all members of db_cpt
+	// Retrieve the data trees associated to db_cpt, if any
+	LinkValuePtr db_lv = LinkValueCast(db_cpt->getValue(db_key()));
+	if (db_lv)
+		return db_lv->to_handle_seq();
+
+	// Otherwise retrieve all members of db_cpt
 	HandleSeq db;
 	IncomingSet member_links = db_cpt->getIncomingSetByType(MEMBER_LINK);
 	for (const Handle& l : member_links) {
@@ -442,6 +460,17 @@ HandleSeq MinerUtils::get_db(const Handle& db_cpt)
 	return db;
 }
 
+const Handle& MinerUtils::db_key()
+{
+	static Handle dbk(createNode(NODE, "*-DataTreesKey-*"));
+	return dbk;
+}
+
+void MinerUtils::set_db(const Handle& db_cpt, const HandleSeq& db)
+{
+	db_cpt->setValue(db_key(), createLinkValue(db));
+}
+
 unsigned MinerUtils::get_uint(const Handle& h)
 {
 	return (unsigned)std::round(get_double(h));
@@ -456,6 +485,8 @@ unsigned MinerUtils::support(const Handle& pattern,
                              const HandleSeq& db,
                              unsigned ms)
 {
+	MinerTrace::Scope trace("support", pattern, db.size());
+
 	// Partition the pattern into strongly connected components
 	HandleSeq cps(get_component_patterns(pattern));
 
@@ -470,7 +501,9 @@ unsigned MinerUtils::support(const Handle& pattern,
 	                 { return component_support(cp, db, ms); });
 
 	// Return the product of all frequencies
-	return boost::accumulate(freqs, 1, std::multiplies<unsigned>());
+	unsigned sup = boost::accumulate(freqs, 1, std::multiplies<unsigned>());
+	trace.rows(sup);
+	return sup;
 }
 
 unsigned MinerUtils::component_support(const Handle& component,
@@ -506,7 +539,8 @@ HandleSet MinerUtils::shallow_specialize(const Handle& pattern,
                                          unsigned mv,
                                          bool enable_type,
                                          bool enable_glob,
-                                         const HandleSeq& ignore_vars)
+                                         const HandleSeq& ignore_vars,
+                                         NegativeBorder* nb)
 {
 	// LAZY_MINER_LOG_FINE << "MinerUtils::shallow_specialize("
 	//                     << "pattern=" << oc_to_string(pattern)
@@ -517,9 +551,25 @@ HandleSet MinerUtils::shallow_specialize(const Handle& pattern,
 	//                     << ", enable_glob=" << enable_glob
 	//                     << ", ignore_vars=" << oc_to_string(ignore_vars) << ")";
 
+	MinerStats::Timer timer(MinerStats::ShallowSpecialize);
+	MinerTrace::Scope trace("shallow_specialize", pattern, db.size());
+
+	// If pattern is known to be infrequent, so are its specializations
+	if (nb and nb->is_infrequent(pattern, ms))
+		return {};
+
+	// Record pattern in the negative border if it is infrequent. Its
+	// support is usually memoized already, by the search that
+	// produced it.
+	if (nb and support_mem(pattern, db, ms) < ms) {
+		nb->insert(pattern, ms);
+		return {};
+	}
+
 	// Calculate all shallow abstractions of pattern
+	Valuations valuations(pattern, db);
 	HandleSetSeq shabs_per_var =
-			shallow_abstract(pattern, db, ms, enable_type, enable_glob, ignore_vars);
+			shallow_abstract(valuations, ms, enable_type, enable_glob, ignore_vars);
 
 	// For each variable of pattern, generate the corresponding shallow
 	// specializations
@@ -533,13 +583,15 @@ HandleSet MinerUtils::shallow_specialize(const Handle& pattern,
 				continue;
 
 			// Set the count of npat, stored in its shallow abstraction
-			set_support(npat, get_support(sa));
+			set_support(npat, get_support(sa), get_support_cap(sa));
 			// Shallow_abstract should already have eliminated shallow
 			// abstraction that do not have enough support.
 			results.insert(npat);
 		}
 		vari++;
 	}
+	timer.rows(results.size());
+	trace.rows(results.size());
 	return results;
 }
 
@@ -621,15 +673,38 @@ Handle MinerUtils::restricted_satisfying_set(const Handle& pattern,
                                              const HandleSeq& db,
                                              unsigned ms)
 {
-	static AtomSpacePtr tmp_db_as = createAtomSpace(); // TODO: fix to be thread safe
-	tmp_db_as->clear();
-	HandleSeq tmp_db;
-	for (const auto& dt : db)
-		tmp_db.push_back(tmp_db_as->add_atom(dt));
+	MinerStats::Timer timer(MinerStats::RestrictedSatisfyingSet);
+
+	// Copy of db in its own atomspace, to restrict the pattern
+	// matcher to it. It is per thread, and only renewed when db
+	// changes, so that consecutive calls over the same db (such as
+	// within a surprisingness batch) do not copy it over and over.
+	// The db is identified by the content of its data trees (see
+	// db_fingerprint), which costs much less than copying it or
+	// running the pattern matcher over it.
+	thread_local AtomSpacePtr tmp_db_as = createAtomSpace();
+	thread_local size_t last_size = 0;
+	thread_local size_t last_fp = 0;
+	thread_local HandleSeq tmp_db;
+	size_t db_fp = db_fingerprint(db);
+	if (db.size() == last_size and db_fp == last_fp) {
+		MinerStats::hit(MinerStats::RestrictedSatisfyingSet);
+	} else {
+		MinerStats::miss(MinerStats::RestrictedSatisfyingSet);
+		tmp_db_as->clear();
+		tmp_db.clear();
+		for (const auto& dt : db)
+			tmp_db.push_back(tmp_db_as->add_atom(dt));
+		last_size = db.size();
+		last_fp = db_fp;
+	}
 
-	// Avoid pattern matcher warning
-	if (totally_abstract(pattern) and n_conjuncts(pattern) == 1)
-		return tmp_db_as->add_link(SET_LINK, std::move(tmp_db));
+	// Avoid pattern matcher warning. Note that the set is not added to
+	// tmp_db_as so that it does not pollute the next queries.
+	if (totally_abstract(pattern) and n_conjuncts(pattern) == 1) {
+		timer.rows(tmp_db.size());
+		return Handle(createUnorderedLink(HandleSeq(tmp_db), SET_LINK));
+	}
 
 	// Define pattern to run
 	AtomSpacePtr tmp_query_as(createAtomSpace(tmp_db_as));
@@ -646,9 +721,19 @@ Handle MinerUtils::restricted_satisfying_set(const Handle& pattern,
 
 	QueueValuePtr qv(sater.get_result_queue());
 	HandleSeq hs(qv->to_handle_seq());
+	timer.rows(hs.size());
 	return Handle(createUnorderedLink(std::move(hs), SET_LINK));
 }
 
+size_t MinerUtils::db_fingerprint(const HandleSeq& db)
+{
+	size_t seed = db.size();
+	for (const Handle& dt : db)
+		boost::hash_combine(seed, dt->get_hash());
+	// 0 stands for no fingerprint
+	return seed == 0 ? 1 : seed;
+}
+
 bool MinerUtils::totally_abstract(const Handle& pattern)
 {
 	// Check whether it is an abstraction to begin with
@@ -791,8 +876,8 @@ void MinerUtils::remove_redundant_subclauses(HandleSeq& clauses)
 {
 	// Check that each clause is not a subtree of another clause,
 	// remove it otherwise.
-	remove_if(clauses, [](const Handle& clause, const HandleSeq& others) {
-			return is_unquoted_unscoped_in_any_tree(others, clause); });
+	remove_if(clauses, [](const Handle& clause, const ClauseView& others) {
+			return is_redundant_subclause(clause, others); });
 }
 
 void MinerUtils::remove_redundant_clauses(HandleSeq& clauses)
@@ -809,7 +894,8 @@ void MinerUtils::remove_abstract_clauses(HandleSeq& clauses)
 	// For each clause, for each variable of that clause, check whether
 	// such clause is an abstraction of all other clauses where such
 	// variable appears, if so, then it can be removed.
-	remove_if(clauses, &MinerUtils::is_more_abstract_foreach_var);
+	remove_if(clauses, [](const Handle& clause, const ClauseView& others) {
+			return is_more_abstract_foreach_var(clause, others); });
 }
 
 bool MinerUtils::has_only_joint_variables(const Handle& clause,
@@ -846,10 +932,45 @@ bool MinerUtils::is_pat_syntax_more_abstract(const Handle& l_pat,
 	l_vars.erase(var);
 	r_vars.erase(var);
 
+	if (not is_syntax_matchable(l_body, l_vars) or
+	    not is_syntax_matchable(r_body, r_vars))
+		return is_pat_syntax_more_abstract_unify(l_body, r_body,
+		                                         l_vars, r_vars, var);
+
+	// Fast negative path, the type and arity of the bodies must be the
+	// same, unless l_body is a variable.
+	bool result = false;
+	if (l_vars.varset_contains(l_body) or
+	    (l_body->get_type() == r_body->get_type() and
+	     l_body->get_arity() == r_body->get_arity())) {
+		SyntaxMatch sm;
+		result = syntax_match(l_body, r_body, l_vars, r_vars, sm);
+	}
+
+#ifndef NDEBUG
+	// Unification is stricter, as it rejects l_pat if any of its
+	// solutions, i.e. any permutation of unordered links, maps a
+	// variable of r_pat to a value, so it may only accept when
+	// matching does.
+	OC_ASSERT(result or not is_pat_syntax_more_abstract_unify(l_body, r_body,
+	                                                          l_vars, r_vars,
+	                                                          var),
+	          "Unification accepts what matching rejects:\n"
+	          "l_pat:\n%s\nr_pat:\n%s\nvar:\n%s",
+	          oc_to_string(l_pat).c_str(), oc_to_string(r_pat).c_str(),
+	          oc_to_string(var).c_str());
+#endif
+
+	return result;
+}
+
+bool MinerUtils::is_pat_syntax_more_abstract_unify(const Handle& l_body,
+                                                   const Handle& r_body,
+                                                   const Variables& l_vars,
+                                                   const Variables& r_vars,
+                                                   const Handle& var)
+{
 	// Find all mappings from variables (except var) to terms.
-	//
-	// TODO: maybe this can be optimized by using matching instead of
-	// unification.
 	Unify unify(l_body, r_body, l_vars, r_vars);
 	Unify::SolutionSet sol = unify();
 
@@ -870,6 +991,126 @@ bool MinerUtils::is_pat_syntax_more_abstract(const Handle& l_pat,
 	return true;
 }
 
+bool MinerUtils::syntax_match(const Handle& l_term,
+                              const Handle& r_term,
+                              const Variables& l_vars,
+                              const Variables& r_vars,
+                              SyntaxMatch& sm)
+{
+	return syntax_match(SyntaxGoals{{l_term, r_term, false}},
+	                    l_vars, r_vars, sm);
+}
+
+bool MinerUtils::syntax_equal(const Handle& l_term,
+                              const Handle& r_term,
+                              const Variables& r_vars,
+                              SyntaxMatch& sm)
+{
+	static const Variables no_variables;
+	return syntax_match(SyntaxGoals{{l_term, r_term, true}},
+	                    no_variables, r_vars, sm);
+}
+
+bool MinerUtils::syntax_match(SyntaxGoals goals,
+                              const Variables& l_vars,
+                              const Variables& r_vars,
+                              SyntaxMatch& sm)
+{
+	// The goals are processed from the back, so the outgoings of a
+	// link are pushed in reverse order.
+	while (not goals.empty()) {
+		SyntaxGoal goal = goals.back();
+		goals.pop_back();
+		const Handle& l_term = goal.l_term;
+		const Handle& r_term = goal.r_term;
+
+		if (goal.equal) {
+			// Two right variables can be equated, a right variable
+			// and a value cannot.
+			bool l_is_var = r_vars.varset_contains(l_term);
+			bool r_is_var = r_vars.varset_contains(r_term);
+			if (l_is_var and r_is_var) {
+				Handle l_rep = syntax_rep(l_term, sm);
+				Handle r_rep = syntax_rep(r_term, sm);
+				if (not content_eq(l_rep, r_rep))
+					sm.r_rep[l_rep] = r_rep;
+				continue;
+			}
+			if (l_is_var or r_is_var)
+				return false;
+		} else {
+			// Left variable, map it or make sure its mapping is
+			// consistent
+			if (l_vars.varset_contains(l_term)) {
+				auto it = sm.l2r.find(l_term);
+				if (it == sm.l2r.end())
+					sm.l2r[l_term] = r_term;
+				else
+					goals.push_back({it->second, r_term, true});
+				continue;
+			}
+
+			// A right variable cannot be mapped to a value
+			if (r_vars.varset_contains(r_term))
+				return false;
+		}
+
+		// Compare the structures
+		if (l_term->is_node() or r_term->is_node()) {
+			if (not content_eq(l_term, r_term))
+				return false;
+			continue;
+		}
+		if (l_term->get_type() != r_term->get_type() or
+		    l_term->get_arity() != r_term->get_arity())
+			return false;
+
+		const HandleSeq& l_out = l_term->getOutgoingSet();
+		const HandleSeq& r_out = r_term->getOutgoingSet();
+		if (nameserver().isA(l_term->get_type(), UNORDERED_LINK)) {
+			// Try all permutations of the right outgoings, each along
+			// with the remaining goals, so that a choice made here can
+			// be revised if it makes an enclosing or following term
+			// fail to match.
+			std::vector<size_t> perm(r_out.size());
+			for (size_t i = 0; i < perm.size(); i++)
+				perm[i] = i;
+			do {
+				SyntaxGoals pgoals(goals);
+				for (size_t i = l_out.size(); 0 < i; i--)
+					pgoals.push_back({l_out[i-1], r_out[perm[i-1]], goal.equal});
+				SyntaxMatch psm(sm);
+				if (syntax_match(std::move(pgoals), l_vars, r_vars, psm)) {
+					sm = std::move(psm);
+					return true;
+				}
+			} while (std::next_permutation(perm.begin(), perm.end()));
+			return false;
+		}
+
+		for (size_t i = l_out.size(); 0 < i; i--)
+			goals.push_back({l_out[i-1], r_out[i-1], goal.equal});
+	}
+	return true;
+}
+
+Handle MinerUtils::syntax_rep(const Handle& var, const SyntaxMatch& sm)
+{
+	Handle rep = var;
+	for (auto it = sm.r_rep.find(rep); it != sm.r_rep.end();
+	     it = sm.r_rep.find(rep))
+		rep = it->second;
+	return rep;
+}
+
+bool MinerUtils::is_syntax_matchable(const Handle& body, const Variables& vars)
+{
+	return vars._typemap.empty()
+		and not contains_atomtype(body, GLOB_NODE)
+		and not contains_atomtype(body, QUOTE_LINK)
+		and not contains_atomtype(body, UNQUOTE_LINK);
+}
+
 bool MinerUtils::is_pat_more_abstract(const Handle& l_pat,
                                       const Handle& r_pat,
                                       const Handle& var)
@@ -898,30 +1139,46 @@ bool MinerUtils::is_blk_more_abstract(const HandleSeq& l_blk,
 
 bool MinerUtils::is_more_abstract_foreach_var(const Handle& clause,
                                               const HandleSeq& others)
+{
+	std::vector<bool> removed(others.size(), false);
+	return is_more_abstract_foreach_var(clause,
+	                                    ClauseView(others, removed, others.size()));
+}
+
+bool MinerUtils::is_more_abstract_foreach_var(const Handle& clause,
+                                              const ClauseView& others)
 {
 	HandleSet vars = get_free_variables(clause);
 	for (const Handle& var : vars) {
-		// Filter in all other clauses containing var
-		HandleSeq ov;
-		for (const Handle& other : others)
-			if (is_free_in_tree(other, var))
-				ov.push_back(other);
+		// Check if clause is an abstraction of each other clause
+		// containing var, relative to var
+		bool found = false;
+		for (const Handle& other : others) {
+			if (not is_free_in_tree(other, var))
+				continue;
+			found = true;
+			if (not is_blk_syntax_more_abstract({clause}, {other}, var))
+				return false;
+		}
 
 		// If var appears nowhere in others, then return false, because
 		// it means such pattern brings something about that variable
 		// that no other pattern brings, thus cannot be an abstraction.
-		if (ov.empty())
-			return false;
-
-		// Check if clause is an abstraction of each clause in ov
-		// relative to var
-		if (not boost::algorithm::all_of(ov, [&](const Handle& other) {
-					return is_blk_syntax_more_abstract({clause}, {other}, var); }))
+		if (not found)
 			return false;
 	}
 	return true;
 }
 
+bool MinerUtils::is_redundant_subclause(const Handle& clause,
+                                        const ClauseView& others)
+{
+	for (const Handle& other : others)
+		if (is_unquoted_unscoped_in_tree(other, clause))
+			return true;
+	return false;
+}
+
 HandleSeqSeq MinerUtils::powerseq_without_empty(const HandleSeq& blk)
 {
 	HandleSetSet pset = powerset(HandleSet(blk.begin(), blk.end()));
@@ -934,11 +1191,18 @@ HandleSeqSeq MinerUtils::powerseq_without_empty(const HandleSeq& blk)
 
 Handle MinerUtils::alpha_convert(const Handle& pattern,
                                  const Variables& other_vars)
+{
+	HandleMap aconv;
+	return alpha_convert(pattern, other_vars, aconv);
+}
+
+Handle MinerUtils::alpha_convert(const Handle& pattern,
+                                 const Variables& other_vars,
+                                 HandleMap& aconv)
 {
 	const Variables& pattern_vars = get_variables(pattern);
 
 	// Detect collision between pattern_vars and other_vars
-	HandleMap aconv;
 	for (const Handle& var : pattern_vars.varset) {
 		if (other_vars.varset_contains(var)) {
 			Handle nvar;
@@ -1101,33 +1365,87 @@ Handle MinerUtils::expand_conjunction_connect(const Handle& cnjtion,
                                               const Handle& pattern,
                                               const HandleMap& pv2cv)
 {
-	// Substitute pattern variables by cnjtion variables in pattern
-	Variables pattern_vars = get_variables(pattern);
-	Handle npat_body = pattern_vars.substitute_nocheck(get_body(pattern), pv2cv);
-	for (const auto& el : pv2cv)
-		pattern_vars.erase(el.first);
-
-	// Extend cnjtion variables with the pattern variables, except
-	// mapped variables
-	Variables cnjtion_vars = get_variables(cnjtion);
-	cnjtion_vars.extend(pattern_vars);
+	// Consecutive calls typically expand the same cnjtion with the
+	// same pattern according to different mappings, thus the builder
+	// is kept and reused as long as cnjtion and pattern are unchanged.
+	thread_local std::unique_ptr<ConjunctionBuilder> builder;
+	if (not builder or not builder->is_for(cnjtion, pattern))
+		builder.reset(new ConjunctionBuilder(cnjtion, pattern));
+	return (*builder)(pv2cv);
+}
 
-	// Expand cnjtion body with npat_body, flattening cnjtion_body if necessary
-	const Handle& cnjtion_body = get_body(cnjtion);
-	HandleSeq nclauses = get_clauses(cnjtion_body);
-	append(nclauses, get_clauses_of_body(npat_body));
+HandleMap MinerUtils::interchangeable_predecessors(const Handle& pattern)
+{
+	const Variables& vars = get_variables(pattern);
+	if (not vars._typemap.empty() or vars.size() < 2)
+		return {};
 
-	// get new variable declaration
-	Handle nvardecl = cnjtion_vars.get_vardecl();
+	// Join into the same class variables that can be swapped without
+	// altering the body. Since transpositions compose, any
+	// permutation within a class leaves the body unchanged as well.
+	const Handle& body = get_body(pattern);
+	std::vector<unsigned> root(vars.size());
+	for (unsigned i = 0; i < root.size(); i++)
+		root[i] = i;
+	auto find = [&](unsigned i) {
+		while (root[i] != i)
+			i = root[i] = root[root[i]];
+		return i;
+	};
+	for (unsigned i = 0; i < vars.size(); i++) {
+		for (unsigned j = i + 1; j < vars.size(); j++) {
+			if (find(i) == find(j))
+				continue;
+			const Handle& vi = vars.varseq[i];
+			const Handle& vj = vars.varseq[j];
+			HandleMap swap{{vi, vj}, {vj, vi}};
+			if (content_eq(vars.substitute_nocheck(body, swap), body))
+				root[find(j)] = find(i);
+		}
+	}
 
-	// Remove useless clauses, such as constant, redundant or abstract
-	// clauses.
-	remove_useless_clauses(nvardecl, nclauses);
+	// Map each variable to the previous variable of its class
+	HandleMap prd;
+	std::map<unsigned, Handle> last;
+	for (unsigned i = 0; i < vars.size(); i++) {
+		unsigned r = find(i);
+		auto it = last.find(r);
+		if (it != last.end())
+			prd[vars.varseq[i]] = it->second;
+		last[r] = vars.varseq[i];
+	}
+	return prd;
+}
 
-	// Recreate expanded conjunction
-	Handle npattern = mk_pattern(nvardecl, nclauses);
+bool MinerUtils::is_canonical_extension(const HandleMap& pv2cv,
+                                        const Handle& pv,
+                                        const Handle& cv,
+                                        const Variables& cvars,
+                                        const HandleMap& pprd)
+{
+	auto prd_it = pprd.find(pv);
+	if (prd_it == pprd.end())
+		return true;
+	auto prd_cv_it = pv2cv.find(prd_it->second);
+	if (prd_cv_it == pv2cv.end())
+		return false;
+	return cvars.index.at(prd_cv_it->second) <= cvars.index.at(cv);
+}
 
-	return npattern;
+bool MinerUtils::is_canonical_image(const HandleMap& pv2cv,
+                                    const HandleMap& cprd)
+{
+	if (cprd.empty())
+		return true;
+	HandleSet image;
+	for (const auto& el : pv2cv)
+		image.insert(el.second);
+	for (const Handle& cv : image) {
+		auto prd_it = cprd.find(cv);
+		if (prd_it != cprd.end() and image.find(prd_it->second) == image.end())
+			return false;
+	}
+	return true;
 }
 
 HandleSet MinerUtils::expand_conjunction_rec(const Handle& cnjtion,
@@ -1136,38 +1454,55 @@ HandleSet MinerUtils::expand_conjunction_rec(const Handle& cnjtion,
                                              unsigned ms,
                                              unsigned mv,
                                              const HandleMap& pv2cv,
-                                             unsigned pvi)
+                                             unsigned pvi,
+                                             const HandleMap& pprd,
+                                             const HandleMap& cprd,
+                                             size_t db_fp)
 {
 	HandleSet patterns;
 	const Variables& cvars = get_variables(cnjtion);
 	const Variables& pvars = get_variables(pattern);
 	for (; pvi < pvars.size(); pvi++) {
+		const Handle& pv = pvars.varseq[pvi];
 		for (const Handle& cv : cvars.varseq) {
+			// Non-canonical mappings, and their extensions, lead to
+			// patterns equivalent to canonical ones, skip them.
+			if (not is_canonical_extension(pv2cv, pv, cv, cvars, pprd))
+				continue;
+
 			HandleMap pv2cv_ext(pv2cv);
-			pv2cv_ext[pvars.varseq[pvi]] = cv;
-			Handle npat = expand_conjunction_connect(cnjtion, pattern, pv2cv_ext);
-
-			// If the number of variables is too high or the number of
-			// conjuncts has dropped then it shouldn't be considered.
-			if (get_variables(npat).size() <= mv and
-			    n_conjuncts(cnjtion) < n_conjuncts(npat)) {
-
-				// Insert npat in the atomspace where cnjtion and pattern
-				// are, before memoizing its support.
-				if (cnjtion->getAtomSpace())
-					npat = cnjtion->getAtomSpace()->add_atom(npat);
-
-				// If npat does not have enough support, any recursive
-				// call will produce specializations that do not have
-				// enough support, thus can be ignored.
-				if (not enough_support(npat, db, ms))
-					continue;
-
-				patterns.insert(npat);
+			pv2cv_ext[pv] = cv;
+
+			// Only build the pattern if the image of the mapping is
+			// canonical, its extensions however may still be.
+			if (is_canonical_image(pv2cv_ext, cprd)) {
+				Handle npat = expand_conjunction_connect(cnjtion, pattern,
+				                                         pv2cv_ext);
+
+				// If the number of variables is too high or the number of
+				// conjuncts has dropped then it shouldn't be considered.
+				if (get_variables(npat).size() <= mv and
+				    n_conjuncts(cnjtion) < n_conjuncts(npat)) {
+
+					// Insert npat in the atomspace where cnjtion and pattern
+					// are, before memoizing its support.
+					if (cnjtion->getAtomSpace())
+						npat = cnjtion->getAtomSpace()->add_atom(npat);
+
+					// If npat does not have enough support, any recursive
+					// call will produce specializations that do not have
+					// enough support, thus can be ignored.
+					if (not enough_join_support(npat, cnjtion, pattern,
+					                            pv2cv_ext, db, ms, db_fp))
+						continue;
+
+					patterns.insert(npat);
+				}
 			}
 
 			HandleSet rrs = expand_conjunction_rec(cnjtion, pattern, db, ms, mv,
-			                                       pv2cv_ext, pvi + 1);
+			                                       pv2cv_ext, pvi + 1,
+			                                       pprd, cprd, db_fp);
 			patterns.insert(rrs.begin(), rrs.end());
 		}
 	}
@@ -1180,7 +1515,11 @@ HandleSet MinerUtils::expand_conjunction_es_rec(const Handle& cnjtion,
                                                 unsigned ms,
                                                 unsigned mv,
                                                 const HandleMap& pv2cv,
-                                                unsigned pvi)
+                                                unsigned pvi,
+                                                const HandleMap& pprd,
+                                                const HandleMap& cprd,
+                                                NegativeBorder* nb,
+                                                size_t db_fp)
 {
 	const Variables& pvars = get_variables(pattern);
 
@@ -1191,6 +1530,11 @@ HandleSet MinerUtils::expand_conjunction_es_rec(const Handle& cnjtion,
 	// If pv2cv is total (thus specialization is guarantied) then we
 	// can build the conjunction.
 	if (pv2cv.size() == pvars.size()) {
+		// If the image of pv2cv is not canonical, an equivalent
+		// conjunction is built from another mapping.
+		if (not is_canonical_image(pv2cv, cprd))
+			return {};
+
 		Handle npat = expand_conjunction_connect(cnjtion, pattern, pv2cv);
 
 		// If the number of variables is too high or the number of
@@ -1199,6 +1543,11 @@ HandleSet MinerUtils::expand_conjunction_es_rec(const Handle& cnjtion,
 		    n_conjuncts(npat) <= n_conjuncts(cnjtion))
 			return {};
 
+		// If npat specializes a pattern known to be infrequent, it is
+		// infrequent as well.
+		if (nb and nb->is_infrequent(npat, ms))
+			return {};
+
 		// Insert npat in the atomspace where cnjtion and pattern
 		// are, before memoizing its support.
 		if (cnjtion->getAtomSpace())
@@ -1206,8 +1555,12 @@ HandleSet MinerUtils::expand_conjunction_es_rec(const Handle& cnjtion,
 
 		// If npat does not have enough support, it shouldn't be
 		// considered.
-		if (not enough_support(npat, db, ms))
+		if (not enough_join_support(npat, cnjtion, pattern, pv2cv, db, ms,
+		                            db_fp)) {
+			if (nb)
+				nb->insert(npat, ms);
 			return {};
+		}
 
 		return {npat};
 	}
@@ -1218,11 +1571,17 @@ HandleSet MinerUtils::expand_conjunction_es_rec(const Handle& cnjtion,
 
 	HandleSet patterns;
 	const Variables& cvars = get_variables(cnjtion);
+	const Handle& pv = pvars.varseq[pvi];
 	for (const Handle& cv : cvars.varseq) {
+		// Skip mappings leading to equivalent conjunctions
+		if (not is_canonical_extension(pv2cv, pv, cv, cvars, pprd))
+			continue;
+
 		HandleMap pv2cv_ext(pv2cv);
-		pv2cv_ext[pvars.varseq[pvi]] = cv;
+		pv2cv_ext[pv] = cv;
 		HandleSet rrs = expand_conjunction_es_rec(cnjtion, pattern, db, ms,
-		                                          mv, pv2cv_ext, pvi + 1);
+		                                          mv, pv2cv_ext, pvi + 1,
+		                                          pprd, cprd, nb, db_fp);
 		patterns.insert(rrs.begin(), rrs.end());
 	}
 	return patterns;
@@ -1233,16 +1592,36 @@ HandleSet MinerUtils::expand_conjunction(const Handle& cnjtion,
                                          const HandleSeq& db,
                                          unsigned ms,
                                          unsigned mv,
-                                         bool es)
+                                         bool es,
+                                         NegativeBorder* nb)
 {
+	MinerStats::Timer timer(MinerStats::ExpandConjunction);
+
 	// Alpha convert pattern, if necessary, to avoid collisions between
 	// cnjtion variables and pattern variables
-	Handle apat = alpha_convert(pattern, get_variables(cnjtion));
-
-	// Consider all variable mappings from apat to cnjtion
-	return es ?
-		expand_conjunction_es_rec(cnjtion, apat, db, ms, mv)
-		: expand_conjunction_rec(cnjtion, apat, db, ms, mv);
+	HandleMap aconv;
+	Handle apat = alpha_convert(pattern, get_variables(cnjtion), aconv);
+
+	// If the support of the expansions can be obtained by joining the
+	// satisfying sets of cnjtion and pattern, make sure the satisfying
+	// set of pattern, which is likely memoized, is passed on to apat.
+	size_t db_fp = db_fingerprint(db);
+	if (apat != pattern and satisfying_set_mem(cnjtion, db, db_fp).first)
+		alpha_convert_satisfying_set_mem(pattern, apat, aconv, db, db_fp);
+
+	// Detect interchangeable variables in both apat and cnjtion to
+	// avoid considering mappings leading to equivalent patterns
+	HandleMap pprd = interchangeable_predecessors(apat);
+	HandleMap cprd = interchangeable_predecessors(cnjtion);
+
+	// Consider all canonical variable mappings from apat to cnjtion
+	HandleSet expansions = es ?
+		expand_conjunction_es_rec(cnjtion, apat, db, ms, mv,
+		                          HandleMap(), 0, pprd, cprd, nb, db_fp)
+		: expand_conjunction_rec(cnjtion, apat, db, ms, mv,
+		                         HandleMap(), 0, pprd, cprd, db_fp);
+	timer.rows(expansions.size());
+	return expansions;
 }
 
 const Handle& MinerUtils::support_key()
@@ -1251,9 +1630,12 @@ const Handle& MinerUtils::support_key()
 	return ck;
 }
 
-void MinerUtils::set_support(const Handle& pattern, double support)
+void MinerUtils::set_support(const Handle& pattern, double support,
+                             double cap)
 {
-	FloatValuePtr support_fv = createFloatValue(boost::numeric_cast<double>(support));
+	FloatValuePtr support_fv = std::isinf(cap) ?
+		createFloatValue(boost::numeric_cast<double>(support))
+		: createFloatValue(std::vector<double>{support, cap});
 	pattern->setValue(support_key(), ValueCast(support_fv));
 }
 
@@ -1265,32 +1647,286 @@ double MinerUtils::get_support(const Handle& pattern)
 	return -1.0;
 }
 
+double MinerUtils::get_support_cap(const Handle& pattern)
+{
+	FloatValuePtr support_fv = FloatValueCast(pattern->getValue(support_key()));
+	if (support_fv and 1 < support_fv->value().size())
+		return support_fv->value()[1];
+	return std::numeric_limits<double>::infinity();
+}
+
 double MinerUtils::support_mem(const Handle& pattern,
                                const HandleSeq& db,
                                unsigned ms)
 {
 	double sup = get_support(pattern);
-	if (sup < 0) {
+	if (sup < 0 or (get_support_cap(pattern) <= sup and sup < ms)) {
+		MinerStats::miss(MinerStats::SupportMem);
 		sup = support(pattern, db, ms);
-		set_support(pattern, sup);
+		set_support(pattern, sup, ms);
+	} else {
+		MinerStats::hit(MinerStats::SupportMem);
 	}
 	return sup;
 }
 
-void MinerUtils::remove_if(HandleSeq& clauses,
-                           std::function<bool(const Handle&, const HandleSeq&)> fun)
+const Handle& MinerUtils::satisfying_set_key()
 {
-	for (auto it = clauses.begin(); it != clauses.end();) {
-		// Take all clauses except *it
-		HandleSeq others(clauses.begin(), it);
-		others.insert(others.end(), std::next(it), clauses.end());
+	static Handle ssk(createNode(NODE, "*-SatisfyingSetValueKey-*"));
+	return ssk;
+}
 
-		// Remove if fun is true
-		if (fun(*it, others))
-			it = clauses.erase(it);
-		else
-			++it;
+namespace {
+
+// The fingerprint of a db, split in 2 halves so that it is exactly
+// represented by a FloatValue.
+ValuePtr fingerprint_value(size_t db_fp)
+{
+	uint64_t fp = db_fp;
+	return createFloatValue(std::vector<double>{(double)(fp >> 32),
+	                                            (double)(fp & 0xffffffff)});
+}
+
+} // ~namespace
+
+HandlePair MinerUtils::satisfying_set_mem(const Handle& pattern,
+                                          const HandleSeq& db,
+                                          size_t db_fp)
+{
+	if (db_fp == 0)
+		db_fp = db_fingerprint(db);
+	ValuePtr fp_value = fingerprint_value(db_fp);
+
+	// The memo is made of the fingerprint of db, followed by the
+	// satisfying set, if any.
+	LinkValuePtr ss_lv = LinkValueCast(pattern->getValue(satisfying_set_key()));
+	if (ss_lv) {
+		const ValueSeq& ss = ss_lv->value();
+		if (not ss.empty() and *ss[0] == *fp_value) {
+			if (ss.size() == 3)
+				return {HandleCast(ss[1]), HandleCast(ss[2])};
+			return {Handle::UNDEFINED, Handle::UNDEFINED};
+		}
 	}
+
+	// Only patterns with a single strongly connected component, made
+	// of untyped variables and non-variable clauses, are eligible, so
+	// that the join of their satisfying sets matches the semantics of
+	// the pattern matcher.
+	HandlePair result{Handle::UNDEFINED, Handle::UNDEFINED};
+	const Variables& vars = get_variables(pattern);
+	const Handle& body = get_body(pattern);
+	bool eligible = vars._typemap.empty()
+		and not totally_abstract(pattern)
+		and not contains_atomtype(body, GLOB_NODE);
+	if (eligible)
+		for (const Handle& clause : get_clauses(pattern))
+			eligible = eligible and not vars.varset_contains(clause);
+	if (eligible) {
+		HandleSeq cps = get_component_patterns(pattern);
+		if (cps.size() == 1 and get_variables(cps[0]).size() == vars.size()) {
+			// Fetch one more valuation than allowed to detect overflow
+			Handle satset = restricted_satisfying_set(
+				cps[0], db, satisfying_set_mem_max_size + 1);
+			if (satset->get_arity() <= satisfying_set_mem_max_size) {
+				Handle vl(createVariableList(HandleSeq(get_variables(cps[0]).varseq)));
+				result = {vl, satset};
+			}
+		}
+	}
+
+	ValueSeq ss = result.first ?
+		ValueSeq{fp_value, result.first, result.second} : ValueSeq{fp_value};
+	pattern->setValue(satisfying_set_key(), createLinkValue(ss));
+	return result;
+}
+
+void MinerUtils::alpha_convert_satisfying_set_mem(const Handle& pattern,
+                                                  const Handle& apat,
+                                                  const HandleMap& aconv,
+                                                  const HandleSeq& db,
+                                                  size_t db_fp)
+{
+	if (db_fp == 0)
+		db_fp = db_fingerprint(db);
+	HandlePair ss = satisfying_set_mem(pattern, db, db_fp);
+	ValueSeq ass{fingerprint_value(db_fp)};
+	if (ss.first) {
+		const Variables& vars = get_variables(pattern);
+		ass.push_back(vars.substitute_nocheck(ss.first, aconv));
+		ass.push_back(ss.second);
+	}
+	apat->setValue(satisfying_set_key(), createLinkValue(ass));
+}
+
+namespace {
+
+// Hash and equality of valuations, based on content, as valuations
+// may originate from distinct atomspaces.
+struct ValuationHash
+{
+	size_t operator()(const HandleSeq& vals) const
+	{
+		size_t seed = 0;
+		for (const Handle& val : vals)
+			boost::hash_combine(seed, val->get_hash());
+		return seed;
+	}
+};
+
+struct ValuationEqual
+{
+	bool operator()(const HandleSeq& l_vals, const HandleSeq& r_vals) const
+	{
+		return content_eq(l_vals, r_vals);
+	}
+};
+
+// Return the value at index i of a valuation of arity n
+const Handle& valuation_at(const Handle& valuation, size_t n, size_t i)
+{
+	return n == 1 ? valuation : valuation->getOutgoingAtom(i);
+}
+
+} // ~namespace
+
+double MinerUtils::join_support(const Handle& npat,
+                                const Handle& cnjtion,
+                                const Handle& pattern,
+                                const HandleMap& pv2cv,
+                                const HandleSeq& db,
+                                unsigned ms,
+                                size_t db_fp)
+{
+	// If some clause has been removed, npat is not the mere join of
+	// cnjtion and pattern.
+	if (n_conjuncts(npat) != n_conjuncts(cnjtion) + n_conjuncts(pattern))
+		return -1.0;
+
+	if (db_fp == 0)
+		db_fp = db_fingerprint(db);
+	HandlePair c_ss = satisfying_set_mem(cnjtion, db, db_fp);
+	if (not c_ss.first)
+		return -1.0;
+	HandlePair p_ss = satisfying_set_mem(pattern, db, db_fp);
+	if (not p_ss.first)
+		return -1.0;
+
+	const HandleSeq& c_vars = c_ss.first->getOutgoingSet();
+	const HandleSeq& p_vars = p_ss.first->getOutgoingSet();
+	auto position = [](const HandleSeq& vars, const Handle& var) {
+		return std::distance(vars.begin(),
+		                     std::find(vars.begin(), vars.end(), var));
+	};
+
+	// Build the join key, the sequence of distinct cnjtion variables
+	// mapped by pv2cv, alongside their positions in the valuations of
+	// cnjtion, and for each mapped pattern variable, its position in
+	// the valuations of pattern with the position of its image in the
+	// join key.
+	HandleSeq key_vars;
+	std::vector<size_t> c_pos;
+	std::vector<std::pair<size_t, size_t>> p_pos;
+	for (const auto& el : pv2cv) {
+		auto kit = std::find(key_vars.begin(), key_vars.end(), el.second);
+		size_t ki = std::distance(key_vars.begin(), kit);
+		if (kit == key_vars.end()) {
+			key_vars.push_back(el.second);
+			c_pos.push_back(position(c_vars, el.second));
+		}
+		p_pos.emplace_back(position(p_vars, el.first), ki);
+	}
+	for (size_t cp : c_pos)
+		if (c_vars.size() <= cp)
+			return -1.0;
+	for (const auto& pp : p_pos)
+		if (p_vars.size() <= pp.first)
+			return -1.0;
+
+	// Build phase, count the valuations of pattern per join key,
+	// discarding those assigning distinct values to pattern variables
+	// mapped to the same cnjtion variable.
+	std::unordered_map<HandleSeq, unsigned, ValuationHash, ValuationEqual> counts;
+	for (const Handle& p_val : p_ss.second->getOutgoingSet()) {
+		HandleSeq key(key_vars.size());
+		bool consistent = true;
+		for (const auto& pp : p_pos) {
+			const Handle& val = valuation_at(p_val, p_vars.size(), pp.first);
+			if (not key[pp.second])
+				key[pp.second] = val;
+			else if (not content_eq(key[pp.second], val)) {
+				consistent = false;
+				break;
+			}
+		}
+		if (consistent)
+			counts[key]++;
+	}
+
+	// Probe phase, sum the counts of the join keys of cnjtion's
+	// valuations, up to ms.
+	unsigned sup = 0;
+	HandleSeq key(key_vars.size());
+	for (const Handle& c_val : c_ss.second->getOutgoingSet()) {
+		for (size_t i = 0; i < c_pos.size(); i++)
+			key[i] = valuation_at(c_val, c_vars.size(), c_pos[i]);
+		auto it = counts.find(key);
+		if (it != counts.end()) {
+			sup += it->second;
+			if (ms <= sup)
+				break;
+		}
+	}
+	return sup;
+}
+
+bool MinerUtils::enough_join_support(const Handle& npat,
+                                     const Handle& cnjtion,
+                                     const Handle& pattern,
+                                     const HandleMap& pv2cv,
+                                     const HandleSeq& db,
+                                     unsigned ms,
+                                     size_t db_fp)
+{
+	if (get_support(npat) < 0) {
+		double sup = join_support(npat, cnjtion, pattern, pv2cv, db, ms,
+		                          db_fp);
+		if (0 <= sup)
+			set_support(npat, sup, ms);
+	}
+	return enough_support(npat, db, ms);
+}
+
+void MinerUtils::remove_if(HandleSeq& clauses,
+                           std::function<bool(const Handle&, const ClauseView&)> fun)
+{
+	// Flag removed clauses, then compact them away at the end
+	std::vector<bool> removed(clauses.size(), false);
+	bool any_removed = false;
+	for (size_t i = 0; i < clauses.size(); i++) {
+		if (fun(clauses[i], ClauseView(clauses, removed, i))) {
+			removed[i] = true;
+			any_removed = true;
+		}
+	}
+	if (not any_removed)
+		return;
+
+	size_t j = 0;
+	for (size_t i = 0; i < clauses.size(); i++)
+		if (not removed[i])
+			clauses[j++] = std::move(clauses[i]);
+	clauses.resize(j);
+}
+
+void MinerUtils::remove_if(HandleSeq& clauses,
+                           std::function<bool(const Handle&, const HandleSeq&)> fun)
+{
+	HandleSeq others;
+	others.reserve(clauses.size());
+	remove_if(clauses, [&](const Handle& clause, const ClauseView& view) {
+			others.assign(view.begin(), view.end());
+			return fun(clause, others); });
 }
 
 HandleSet MinerUtils::type_restrict_patterns(const HandleSeqMap& shapats)
@@ -23,6 +23,10 @@
 #ifndef OPENCOG_MINER_UTILS_H_
 #define OPENCOG_MINER_UTILS_H_
 
+#include <iterator>
+#include <limits>
+#include <vector>
+
 #include <opencog/util/empty_string.h>
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/unify/Unify.h>
@@ -32,6 +36,8 @@
 namespace opencog
 {
 
+class NegativeBorder;
+
 typedef std::vector<HandleSeqSeq> HandleSeqSeqSeq;
 typedef std::pair<HandleSet, GlobInterval> ValIntvlPair;
 typedef std::map<Handle, ValIntvlPair> HandleValIntvlMap;
@@ -197,10 +203,23 @@ public:
 	static Handle compose_nocheck(const Handle& pattern, const HandlePair& var2pat);
 
 	/**
-	 * Given a db concept node, retrieve all its members
+	 * Given a db concept node, retrieve all its members, that is the
+	 * data trees associated to it by set_db, if any, or otherwise the
+	 * atoms linked to it by MemberLinks.
 	 */
 	static HandleSeq get_db(const Handle& db_cpt);
 
+	/**
+	 * Key of the data trees associated to a db concept node
+	 */
+	static const Handle& db_key();
+
+	/**
+	 * Associate data trees to a db concept node, in place of its
+	 * members, so that no MemberLink is needed (see DBLoader).
+	 */
+	static void set_db(const Handle& db_cpt, const HandleSeq& db);
+
 	/**
 	 * Return the non-negative integer held by a number node.
 	 */
@@ -271,6 +290,11 @@ public:
 	 * ignore_vars is a set of variables not to specialize.  This is
 	 * convenient for instance for temporal mining, where the temporal
 	 * variable must not be specialized.
+	 *
+	 * nb is an optional negative border. If pattern is known to be
+	 * infrequent according to it, no specialization is produced
+	 * without calculating the valuations of pattern. Otherwise, if
+	 * pattern turns out to be infrequent, it is recorded in nb.
 	 */
 	static HandleSet shallow_specialize(const Handle& pattern,
 	                                    const HandleSeq& db,
@@ -278,7 +302,8 @@ public:
 	                                    unsigned mv=UINT_MAX,
 	                                    bool enable_type=false,
 	                                    bool enable_glob=false,
-	                                    const HandleSeq& ignore_vars={});
+	                                    const HandleSeq& ignore_vars={},
+	                                    NegativeBorder* nb=nullptr);
 
 	/**
 	 * Create a pattern body from clauses, introducing an AndLink if
@@ -357,6 +382,12 @@ public:
 	                                        const HandleSeq& db,
 	                                        unsigned ms=UINT_MAX);
 
+	/**
+	 * Return a hash of db based on the content of its data trees,
+	 * never 0.
+	 */
+	static size_t db_fingerprint(const HandleSeq& db);
+
 	/**
 	 * Return true iff the pattern is totally abstract like
 	 *
@@ -510,15 +541,118 @@ public:
 	 * Like above but takes scope links instead of blocks (whether each
 	 * scope link has the conjunction of clauses of its block as body).
 	 *
-	 * TODO: for now, this code relies on unification. However it can
-	 * certainly be optimized by not relying on unification and being
-	 * re-implemented instead, and perhaps it could then be merged to
-	 * the unification code.
+	 * This relies on syntax_match, a one-way matcher, rather than
+	 * unification. Unification is only used when the patterns contain
+	 * constructs that syntax_match does not support (see
+	 * is_syntax_matchable), and, in debug builds, to check that it
+	 * does not accept what syntax_match rejects.
+	 *
+	 * Unordered links, such as conjunctions of clauses, are compared
+	 * up to permutation, that is l_pat is more abstract than r_pat if
+	 * some permutation of its unordered links matches r_pat. For
+	 * instance
+	 *
+	 * Lambda
+	 *   VariableSet X Z
+	 *   Present
+	 *     Inheritance Z X
+	 *     Inheritance Z (Concept "A")
+	 *
+	 * is more abstract than itself relative to Z, mapping X to X,
+	 * even though the other permutation would map X to
+	 * (Concept "A"). Unification instead rejects l_pat if any
+	 * permutation maps a variable of r_pat to a value, and thus gives
+	 * the same answer in fewer cases.
 	 */
 	static bool is_pat_syntax_more_abstract(const Handle& l_pat,
 	                                        const Handle& r_pat,
 	                                        const Handle& var);
 
+	/**
+	 * Unification based version of is_pat_syntax_more_abstract, where
+	 * var has already been removed from l_vars and r_vars.
+	 */
+	static bool is_pat_syntax_more_abstract_unify(const Handle& l_body,
+	                                              const Handle& r_body,
+	                                              const Variables& l_vars,
+	                                              const Variables& r_vars,
+	                                              const Handle& var);
+
+	/**
+	 * State of syntax_match. l2r maps the variables of the left term
+	 * to subterms of the right term, and r_rep maps variables of the
+	 * right term to their representative, when several of them have to
+	 * be equal for the match to go through (a union-find of sort).
+	 */
+	struct SyntaxMatch
+	{
+		HandleMap l2r;
+		HandleMap r_rep;
+	};
+
+	/**
+	 * Pair of terms left to match by syntax_match. If equal is true
+	 * then both are right terms to be compared by syntax_equal.
+	 */
+	struct SyntaxGoal
+	{
+		Handle l_term;
+		Handle r_term;
+		bool equal;
+	};
+	typedef std::vector<SyntaxGoal> SyntaxGoals;
+
+	/**
+	 * One-way structural matcher. Return true iff l_term matches
+	 * r_term, that is the variables of l_term (in l_vars) can be
+	 * mapped to subterms of r_term so that l_term becomes r_term,
+	 * modulo equating variables of r_term (in r_vars) with each
+	 * other. Variables of r_term can never be mapped to values.
+	 * Unordered links are matched up to permutation, at any depth,
+	 * that is a permutation is only retained if the rest of the terms
+	 * match as well.
+	 *
+	 * Mappings are accumulated in sm, which is left in an unspecified
+	 * state when the match fails.
+	 */
+	static bool syntax_match(const Handle& l_term,
+	                         const Handle& r_term,
+	                         const Variables& l_vars,
+	                         const Variables& r_vars,
+	                         SyntaxMatch& sm);
+
+	/**
+	 * Return true iff the right terms l_term and r_term are equal,
+	 * modulo equating variables of r_vars with each other, in which
+	 * case these equalities are recorded in sm.
+	 */
+	static bool syntax_equal(const Handle& l_term,
+	                         const Handle& r_term,
+	                         const Variables& r_vars,
+	                         SyntaxMatch& sm);
+
+	/**
+	 * Return the representative of the right variable var in sm.
+	 */
+	static Handle syntax_rep(const Handle& var, const SyntaxMatch& sm);
+
+	/**
+	 * Match all goals, in order, backtracking over the permutations
+	 * of the unordered links they contain. Used by syntax_match and
+	 * syntax_equal.
+	 */
+	static bool syntax_match(SyntaxGoals goals,
+	                         const Variables& l_vars,
+	                         const Variables& r_vars,
+	                         SyntaxMatch& sm);
+
+	/**
+	 * Return true iff body with variables vars is supported by
+	 * syntax_match, that is has no typed variables, globs or
+	 * quotations.
+	 */
+	static bool is_syntax_matchable(const Handle& body, const Variables& vars);
+
 	/**
 	 * Like is_syntax_more_abstract but takes into account a bit of
 	 * semantics as well (though none that requires data), in
@@ -566,6 +700,63 @@ public:
 	                                 const HandleSeq& r_blk,
 	                                 const Handle& var);
 
+	/**
+	 * Read-only view over a sequence of clauses, excluding the clause
+	 * at index excluded and the clauses flagged in removed. Used to
+	 * pass to a predicate the other clauses of a given clause without
+	 * copying them (see remove_if).
+	 */
+	class ClauseView
+	{
+	public:
+		class const_iterator
+		{
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef Handle value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const Handle* pointer;
+			typedef const Handle& reference;
+
+			const_iterator(const ClauseView& view, size_t i)
+				: _view(&view), _i(view.next(i)) {}
+
+			reference operator*() const { return (*_view->_clauses)[_i]; }
+			pointer operator->() const { return &(*_view->_clauses)[_i]; }
+			const_iterator& operator++() { _i = _view->next(_i + 1); return *this; }
+			const_iterator operator++(int) { const_iterator it(*this); ++*this; return it; }
+			bool operator==(const const_iterator& other) const { return _i == other._i; }
+			bool operator!=(const const_iterator& other) const { return _i != other._i; }
+
+		private:
+			const ClauseView* _view;
+			size_t _i;
+		};
+
+		ClauseView(const HandleSeq& clauses,
+		           const std::vector<bool>& removed,
+		           size_t excluded)
+			: _clauses(&clauses), _removed(&removed), _excluded(excluded) {}
+
+		const_iterator begin() const { return const_iterator(*this, 0); }
+		const_iterator end() const { return const_iterator(*this, _clauses->size()); }
+		bool empty() const { return begin() == end(); }
+
+	private:
+		// Return the first index, starting from i, neither excluded nor
+		// removed, or the number of clauses if there is none.
+		size_t next(size_t i) const
+		{
+			while (i < _clauses->size() and (i == _excluded or (*_removed)[i]))
+				i++;
+			return i;
+		}
+
+		const HandleSeq* _clauses;
+		const std::vector<bool>* _removed;
+		size_t _excluded;
+	};
+
 	/**
 	 * Return true iff for each variable v in clause, let o(v) be all
 	 * clauses containing v, clause is more abstract than any clauses
@@ -573,6 +764,15 @@ public:
 	 */
 	static bool is_more_abstract_foreach_var(const Handle& clause,
 	                                         const HandleSeq& others);
+	static bool is_more_abstract_foreach_var(const Handle& clause,
+	                                         const ClauseView& others);
+
+	/**
+	 * Return true iff clause is a subtree of, or equal to, any of the
+	 * other clauses.
+	 */
+	static bool is_redundant_subclause(const Handle& clause,
+	                                   const ClauseView& others);
 
 	/**
 	 * Like powerset but return a sequence of sequences instead of set
@@ -588,6 +788,14 @@ public:
 	static Handle alpha_convert(const Handle& pattern,
 	                            const Variables& other_vars);
 
+	/**
+	 * Like alpha_convert but also return the variable renaming that
+	 * has been applied in aconv.
+	 */
+	static Handle alpha_convert(const Handle& pattern,
+	                            const Variables& other_vars,
+	                            HandleMap& aconv);
+
 	/**
 	 * Return true iff var_val is a pair with the first element a
 	 * variable in vars, and the second element a value (non-variable).
@@ -717,16 +925,78 @@ public:
 	/**
 	 * Like expand_conjunction_connect but consider a mapping from
 	 * variables of pattern to variables of cnjtion.
+	 *
+	 * The expansion is built by a ConjunctionBuilder, which only
+	 * checks the new clauses, and the clauses of cnjtion they may
+	 * affect, for uselessness, assuming cnjtion has no useless
+	 * clauses. The builder is reused across consecutive calls with
+	 * the same cnjtion and pattern.
 	 */
 	static Handle expand_conjunction_connect(const Handle& cnjtion,
 	                                         const Handle& pattern,
 	                                         const HandleMap& pv2cv);
 
+	/**
+	 * Return a map from each variable of pattern to its predecessor,
+	 * according to the order of the variable declaration, in its
+	 * class of interchangeable variables. Two variables are
+	 * interchangeable if swapping them leaves the pattern body
+	 * unchanged (up to the order of unordered links). Variables
+	 * without predecessor, i.e. the first of its class, or alone in
+	 * its class, are not in the map. For instance
+	 *
+	 * pattern = Lambda
+	 *             X Y Z
+	 *             Present
+	 *               Inheritance X Z
+	 *               Inheritance Y Z
+	 *
+	 * return {Y->X}
+	 *
+	 * If pattern has typed variables, the empty map is returned, as
+	 * no symmetry is detected.
+	 */
+	static HandleMap interchangeable_predecessors(const Handle& pattern);
+
+	/**
+	 * Return true iff the partial variable mapping pv2cv, extended
+	 * with pv->cv, is canonical with respect to the interchangeable
+	 * variables of pattern, as given by pprd (see
+	 * interchangeable_predecessors). That is, within each class of
+	 * interchangeable variables of pattern, the mapped variables
+	 * form a prefix and their images have non-decreasing indices in
+	 * cvars.
+	 *
+	 * Since non-canonical mappings only produce patterns equivalent
+	 * to canonical ones, and cannot be extended to canonical ones,
+	 * they can be pruned.
+	 */
+	static bool is_canonical_extension(const HandleMap& pv2cv,
+	                                   const Handle& pv,
+	                                   const Handle& cv,
+	                                   const Variables& cvars,
+	                                   const HandleMap& pprd);
+
+	/**
+	 * Return true iff, within each class of interchangeable variables
+	 * of cnjtion, as given by cprd (see
+	 * interchangeable_predecessors), the variables in the image of
+	 * pv2cv form a prefix. Otherwise the expansion is equivalent to
+	 * the one obtained by permuting the interchangeable variables of
+	 * cnjtion, which is considered instead.
+	 */
+	static bool is_canonical_image(const HandleMap& pv2cv,
+	                               const HandleMap& cprd);
+
 	/**
 	 * Like expand_conjunction_connect but recursively consider all
 	 * variable mappings from pattern to cnjtion.
 	 *
 	 * pvi is the variable index of pattern variable declaration.
+	 *
+	 * pprd and cprd are the interchangeable predecessors of pattern
+	 * and cnjtion variables, used to skip mappings leading to
+	 * equivalent expansions (see interchangeable_predecessors).
 	 */
 	static HandleSet expand_conjunction_rec(const Handle& cnjtion,
 	                                        const Handle& pattern,
@@ -734,13 +1004,20 @@ public:
 	                                        unsigned ms,
 	                                        unsigned mv,
 	                                        const HandleMap& pv2cv=HandleMap(),
-	                                        unsigned pvi=0);
+	                                        unsigned pvi=0,
+	                                        const HandleMap& pprd=HandleMap(),
+	                                        const HandleMap& cprd=HandleMap(),
+	                                        size_t db_fp=0);
 
 	/**
 	 * Like expand_conjunction_rec but enforce specialization. Mean
 	 * only total mappings from the variables of pattern to the
 	 * variables of cnjtion will be considered, as to not introduced
 	 * any new variables.
+	 *
+	 * nb is an optional negative border. Expansions known to be
+	 * infrequent according to it are rejected before calculating
+	 * their support, expansions found infrequent are recorded in it.
 	 */
 	static HandleSet expand_conjunction_es_rec(const Handle& cnjtion,
 	                                           const Handle& pattern,
@@ -748,7 +1025,11 @@ public:
 	                                           unsigned ms,
 	                                           unsigned mv,
 	                                           const HandleMap& pv2cv=HandleMap(),
-	                                           unsigned pvi=0);
+	                                           unsigned pvi=0,
+	                                           const HandleMap& pprd=HandleMap(),
+	                                           const HandleMap& cprd=HandleMap(),
+	                                           NegativeBorder* nb=nullptr,
+	                                           size_t db_fp=0);
 
 	/**
 	 * Given cnjtion and pattern, consider all possible connections
@@ -773,13 +1054,19 @@ public:
 	 *
 	 * es is a flag to enforce specialization by
 	 *    discarding new variables.
+	 *
+	 * nb is an optional negative border, only used if es is true
+	 *    (see expand_conjunction_es_rec). Without enforcing
+	 *    specialization expansions may be abstractions, to which
+	 *    a priori pruning does not apply.
 	 */
 	static HandleSet expand_conjunction(const Handle& cnjtion,
 	                                    const Handle& pattern,
 	                                    const HandleSeq& db,
 	                                    unsigned ms,
 	                                    unsigned mv=UINT_MAX,
-	                                    bool es=true);
+	                                    bool es=true,
+	                                    NegativeBorder* nb=nullptr);
 
 	/**
 	 * Return an atom to serve as key to store the support value.
@@ -791,8 +1078,13 @@ public:
 	 * encoded as double because it is stored as a FloatValue, and its
 	 * subsequent processing (probability estimate, etc) requires a
 	 * double anyway.
+	 *
+	 * cap is the minimum support the calculation has been halted at,
+	 * if any. A support greater than or equal to cap is only a lower
+	 * bound of the actual support.
 	 */
-	static void set_support(const Handle& pattern, double support);
+	static void set_support(const Handle& pattern, double support,
+	                        double cap=std::numeric_limits<double>::infinity());
 
 	/**
 	 * Get the support of a pattern stored as associated value to
@@ -800,24 +1092,124 @@ public:
 	 */
 	static double get_support(const Handle& pattern);
 
+	/**
+	 * Get the cap of the support of a pattern stored as associated
+	 * value to support_key() (see set_support). If there is no such
+	 * cap then return +inf.
+	 */
+	static double get_support_cap(const Handle& pattern);
+
 	/**
 	 * Like get_support, but if there is no value associated to
-	 * support_key() then calculate and set the support.
+	 * support_key(), or if it is a lower bound below ms, then
+	 * calculate and set the support.
 	 *
-	 * Warning: note that the support is gonna be up to ms, so such
-	 * memoization should not be used if ms is to be changed.
+	 * Note that the support is calculated up to ms, thus can be
+	 * memoized as a lower bound, that is recalculated if requested
+	 * with a greater ms.
 	 */
 	static double support_mem(const Handle& pattern,
 	                          const HandleSeq& db,
 	                          unsigned ms);
 
+	/**
+	 * Maximum number of valuations of a satisfying set to be memoized
+	 * by satisfying_set_mem. Larger satisfying sets are not memoized
+	 * and the corresponding patterns are not used in join-based
+	 * support calculation. The memoized satisfying sets live as long
+	 * as their patterns, thus memory grows by up to that many
+	 * valuations per eligible pattern.
+	 */
+	static const unsigned satisfying_set_mem_max_size = 100000;
+
+	/**
+	 * Return an atom to serve as key to store the satisfying set.
+	 */
+	static const Handle& satisfying_set_key();
+
+	/**
+	 * Return the complete satisfying set of pattern against db, as a
+	 * pair (variable list, set of valuations), where the i-th element
+	 * of each valuation is the value of the i-th variable of the
+	 * variable list, or the valuation itself if there is only one
+	 * variable. The result is memoized as associated value to
+	 * satisfying_set_key(), alongside the fingerprint of db (see
+	 * db_fingerprint), so that it is recalculated if pattern is
+	 * queried over another db. db_fp is that fingerprint, calculated
+	 * if 0.
+	 *
+	 * If pattern does not consist of a single strongly connected
+	 * component, is totally abstract, has typed variables, globs,
+	 * variable clauses, or if its satisfying set is larger than
+	 * satisfying_set_mem_max_size, then the pair of undefined handles
+	 * is returned, and memoized as well.
+	 *
+	 * Note that only the last db a pattern has been queried over is
+	 * memoized.
+	 */
+	static HandlePair satisfying_set_mem(const Handle& pattern,
+	                                     const HandleSeq& db,
+	                                     size_t db_fp=0);
+
+	/**
+	 * Memoize the satisfying set of pattern (see satisfying_set_mem)
+	 * to apat, its alpha conversion according to aconv, so that it is
+	 * not recalculated for apat.
+	 */
+	static void alpha_convert_satisfying_set_mem(const Handle& pattern,
+	                                             const Handle& apat,
+	                                             const HandleMap& aconv,
+	                                             const HandleSeq& db,
+	                                             size_t db_fp=0);
+
+	/**
+	 * Given npat, the expansion of cnjtion by pattern according to the
+	 * variable mapping pv2cv (see expand_conjunction_connect),
+	 * calculate its support by joining the satisfying sets of cnjtion
+	 * and pattern on the mapped variables, rather than running the
+	 * pattern matcher over npat. The join stops as soon as the
+	 * support reaches ms.
+	 *
+	 * Return -1.0 if the join cannot be performed, that is if any
+	 * clause has been removed while building npat, or if the
+	 * satisfying set of cnjtion or pattern is not available (see
+	 * satisfying_set_mem). db_fp is the fingerprint of db, calculated
+	 * if 0.
+	 */
+	static double join_support(const Handle& npat,
+	                           const Handle& cnjtion,
+	                           const Handle& pattern,
+	                           const HandleMap& pv2cv,
+	                           const HandleSeq& db,
+	                           unsigned ms,
+	                           size_t db_fp=0);
+
+	/**
+	 * Like enough_support but, if the support of npat is not already
+	 * memoized, attempt to calculate it with join_support first.
+	 */
+	static bool enough_join_support(const Handle& npat,
+	                                const Handle& cnjtion,
+	                                const Handle& pattern,
+	                                const HandleMap& pv2cv,
+	                                const HandleSeq& db,
+	                                unsigned ms,
+	                                size_t db_fp=0);
+
 	/**
 	 * Remove every element of clauses such that
 	 *
 	 * fun(element, clauses - {element})
 	 *
-	 * returns true.
+	 * returns true. Elements are considered in order, and
+	 * clauses - {element} excludes the elements already removed.
+	 *
+	 * The first version passes the other clauses as a view, thus
+	 * only allocates once, the second one passes them as a sequence,
+	 * reusing the same buffer for all elements.
 	 */
+	static void remove_if(HandleSeq& clauses,
+	                      std::function<bool(const Handle&, const ClauseView&)> fun);
 	static void remove_if(HandleSeq& clauses,
 	                      std::function<bool(const Handle&, const HandleSeq&)> fun);
 
@@ -0,0 +1,194 @@
+/*
+ * NegativeBorder.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "NegativeBorder.h"
+#include "MinerUtils.h"
+
+#include <opencog/atoms/core/FindUtils.h>
+
+#include <algorithm>
+
+namespace opencog
+{
+
+NegativeBorder::NegativeBorder(size_t max_size)
+	: _max_size(max_size), _size(0) {}
+
+void NegativeBorder::insert(const Handle& pattern, unsigned ms)
+{
+	if (not is_eligible(pattern))
+		return;
+
+	HandleSeq clauses = MinerUtils::get_clauses(pattern);
+	const Variables& variables = MinerUtils::get_variables(pattern);
+
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	if (_max_size <= _size or is_infrequent_nolock(clauses, variables, ms))
+		return;
+	_index[clause_roots(clauses)].push_back({clauses, variables, ms});
+	_size++;
+}
+
+bool NegativeBorder::is_infrequent(const Handle& pattern, unsigned ms) const
+{
+	if (not is_eligible(pattern))
+		return false;
+
+	HandleSeq clauses = MinerUtils::get_clauses(pattern);
+	const Variables& variables = MinerUtils::get_variables(pattern);
+
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return is_infrequent_nolock(clauses, variables, ms);
+}
+
+size_t NegativeBorder::size() const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return _size;
+}
+
+void NegativeBorder::clear()
+{
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	_index.clear();
+	_size = 0;
+}
+
+bool NegativeBorder::is_eligible(const Handle& pattern)
+{
+	if (pattern->get_type() != LAMBDA_LINK)
+		return false;
+
+	const Variables& variables = MinerUtils::get_variables(pattern);
+	const Handle& body = MinerUtils::get_body(pattern);
+	if (not body or not MinerUtils::is_syntax_matchable(body, variables))
+		return false;
+
+	for (const Handle& clause : MinerUtils::get_clauses(pattern))
+		if (variables.varset_contains(clause))
+			return false;
+	return true;
+}
+
+NegativeBorder::ClauseRoot NegativeBorder::clause_root(const Handle& clause)
+{
+	return {clause->get_type(), clause->get_arity()};
+}
+
+NegativeBorder::ClauseRoots NegativeBorder::clause_roots(const HandleSeq& clauses)
+{
+	std::set<ClauseRoot> roots;
+	for (const Handle& clause : clauses)
+		roots.insert(clause_root(clause));
+	return ClauseRoots(roots.begin(), roots.end());
+}
+
+bool NegativeBorder::is_specialized_by(const Entry& entry,
+                                       const HandleSeq& clauses,
+                                       const Variables& variables)
+{
+	HandleMap l2r;
+	std::vector<bool> matched(clauses.size(), false);
+	return match_clauses(entry, 0, clauses, variables, l2r, matched);
+}
+
+bool NegativeBorder::match_clauses(const Entry& entry, size_t i,
+                                   const HandleSeq& clauses,
+                                   const Variables& variables,
+                                   const HandleMap& l2r,
+                                   std::vector<bool>& matched)
+{
+	// All clauses of entry are matched, every variable of the
+	// candidate must then appear in the matched clauses, otherwise
+	// the candidate may have more support.
+	if (i == entry.clauses.size()) {
+		for (const Handle& var : variables.varseq) {
+			bool found = false;
+			for (size_t j = 0; not found and j < clauses.size(); j++)
+				found = matched[j] and is_free_in_tree(clauses[j], var);
+			if (not found)
+				return false;
+		}
+		return true;
+	}
+
+	// The variables of the candidate are viewed as constants
+	static const Variables no_variables;
+	const Handle& l_clause = entry.clauses[i];
+	for (size_t j = 0; j < clauses.size(); j++) {
+		if (clause_root(l_clause) != clause_root(clauses[j]))
+			continue;
+		MinerUtils::SyntaxMatch sm{l2r, {}};
+		if (not MinerUtils::syntax_match(l_clause, clauses[j],
+		                                 entry.variables, no_variables, sm))
+			continue;
+		bool was_matched = matched[j];
+		matched[j] = true;
+		if (match_clauses(entry, i + 1, clauses, variables, sm.l2r, matched))
+			return true;
+		matched[j] = was_matched;
+	}
+	return false;
+}
+
+bool NegativeBorder::is_infrequent_nolock(const HandleSeq& clauses,
+                                          const Variables& variables,
+                                          unsigned ms) const
+{
+	ClauseRoots roots = clause_roots(clauses);
+
+	// Too many roots to enumerate their subsets, go over the buckets
+	// instead.
+	if (16 < roots.size()) {
+		for (const auto& bucket : _index)
+			if (std::includes(roots.begin(), roots.end(),
+			                  bucket.first.begin(), bucket.first.end())
+			    and is_infrequent(bucket.second, clauses, variables, ms))
+				return true;
+		return false;
+	}
+
+	// Look up the bucket of each non-empty subset of roots
+	for (size_t mask = 1; mask < ((size_t)1 << roots.size()); mask++) {
+		ClauseRoots subset;
+		for (size_t i = 0; i < roots.size(); i++)
+			if (mask & ((size_t)1 << i))
+				subset.push_back(roots[i]);
+		auto it = _index.find(subset);
+		if (it != _index.end()
+		    and is_infrequent(it->second, clauses, variables, ms))
+			return true;
+	}
+	return false;
+}
+
+bool NegativeBorder::is_infrequent(const std::vector<Entry>& entries,
+                                   const HandleSeq& clauses,
+                                   const Variables& variables,
+                                   unsigned ms)
+{
+	for (const Entry& entry : entries)
+		if (entry.ms <= ms and is_specialized_by(entry, clauses, variables))
+			return true;
+	return false;
+}
+
+} // ~namespace opencog
@@ -0,0 +1,172 @@
+/*
+ * NegativeBorder.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_NEGATIVEBORDER_H_
+#define OPENCOG_NEGATIVEBORDER_H_
+
+#include <map>
+#include <set>
+#include <shared_mutex>
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atoms/core/Variables.h>
+
+namespace opencog
+{
+
+/**
+ * Store of patterns known not to reach a minimum support, a.k.a. the
+ * negative border of the search. Since support is anti-monotone
+ * under specialization, any candidate specializing a stored pattern,
+ * with a minimum support greater than or equal to the one the stored
+ * pattern failed at, can be rejected without running the pattern
+ * matcher.
+ *
+ * A stored pattern S is considered to be specialized by a candidate
+ * C if there exists a substitution s of the variables of S such
+ * that every clause of S, once substituted, is a clause of C, and
+ * every variable of C appears in these substituted clauses. The
+ * latter guaranties that distinct groundings of C correspond to
+ * distinct groundings of S, thus that C cannot have more support
+ * than S.
+ *
+ * Only patterns with untyped variables, no globs, no quotations and
+ * no variable clauses are stored and considered as candidates, other
+ * patterns are ignored.
+ *
+ * Stored patterns are indexed by the set of roots (type and arity)
+ * of their clauses. Since every clause of a stored pattern must
+ * match a clause of the candidate, only the stored patterns indexed
+ * by a subset of the roots of the candidate clauses are considered.
+ *
+ * All methods are thread safe. Lookups only take a shared lock, so
+ * that they can proceed concurrently.
+ */
+class NegativeBorder
+{
+public:
+	/**
+	 * CTor. max_size is the maximum number of stored patterns,
+	 * patterns beyond that are ignored.
+	 */
+	NegativeBorder(size_t max_size=100000);
+
+	/**
+	 * Record that pattern does not reach the minimum support ms. If
+	 * pattern already specializes a stored pattern (w.r.t. ms), it is
+	 * not recorded.
+	 */
+	void insert(const Handle& pattern, unsigned ms);
+
+	/**
+	 * Return true iff pattern specializes a stored pattern that does
+	 * not reach a minimum support lower than or equal to ms, thus
+	 * does not reach ms either.
+	 */
+	bool is_infrequent(const Handle& pattern, unsigned ms) const;
+
+	/**
+	 * Return the number of stored patterns.
+	 */
+	size_t size() const;
+
+	/**
+	 * Remove all stored patterns.
+	 */
+	void clear();
+
+private:
+	struct Entry
+	{
+		HandleSeq clauses;
+		Variables variables;
+		unsigned ms;
+	};
+
+	// Type and arity of the root of a clause
+	typedef std::pair<Type, Arity> ClauseRoot;
+
+	// Sorted distinct roots of the clauses of a pattern
+	typedef std::vector<ClauseRoot> ClauseRoots;
+
+	/**
+	 * Return true iff pattern can be stored or checked, that is it
+	 * has untyped variables, no globs, no quotations and no variable
+	 * clauses.
+	 */
+	static bool is_eligible(const Handle& pattern);
+
+	/**
+	 * Return the root of a clause.
+	 */
+	static ClauseRoot clause_root(const Handle& clause);
+
+	/**
+	 * Return the sorted distinct roots of clauses.
+	 */
+	static ClauseRoots clause_roots(const HandleSeq& clauses);
+
+	/**
+	 * Return true iff an entry of the given bucket, that does not
+	 * reach ms, is specialized by the candidate.
+	 */
+	static bool is_infrequent(const std::vector<Entry>& entries,
+	                          const HandleSeq& clauses,
+	                          const Variables& variables,
+	                          unsigned ms);
+
+	/**
+	 * Return true iff the entry is specialized by the candidate with
+	 * the given clauses and variables (see the class description).
+	 */
+	static bool is_specialized_by(const Entry& entry,
+	                              const HandleSeq& clauses,
+	                              const Variables& variables);
+
+	/**
+	 * Recursive helper of is_specialized_by, match the i-th and
+	 * following clauses of entry to some clauses of the candidate,
+	 * given the current variable mapping l2r, and the candidate
+	 * clauses matched so far.
+	 */
+	static bool match_clauses(const Entry& entry, size_t i,
+	                          const HandleSeq& clauses,
+	                          const Variables& variables,
+	                          const HandleMap& l2r,
+	                          std::vector<bool>& matched);
+
+	/**
+	 * Like is_infrequent but assumes the lock is taken and pattern is
+	 * eligible.
+	 */
+	bool is_infrequent_nolock(const HandleSeq& clauses,
+	                          const Variables& variables,
+	                          unsigned ms) const;
+
+	size_t _max_size;
+	size_t _size;
+	std::map<ClauseRoots, std::vector<Entry>> _index;
+	mutable std::shared_mutex _mutex;
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_NEGATIVEBORDER_H_ */
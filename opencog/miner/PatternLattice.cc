@@ -0,0 +1,178 @@
+/*
+ * PatternLattice.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "PatternLattice.h"
+
+#include <sstream>
+
+#include <opencog/atoms/base/Atom.h>
+
+namespace opencog
+{
+
+const PatternLattice::NodeId PatternLattice::no_node;
+const PatternLattice::EdgeId PatternLattice::no_edge;
+
+std::pair<PatternLattice::NodeId, bool> PatternLattice::insert(const Handle& pattern)
+{
+	std::vector<NodeId>& same_hash = _index[pattern->get_hash()];
+	for (NodeId node : same_hash)
+		if (content_eq(_nodes[node].pattern, pattern))
+			return {node, false};
+
+	NodeId node = _nodes.size();
+	_nodes.push_back({pattern, no_edge, no_edge, no_edge, no_edge});
+	same_hash.push_back(node);
+	return {node, true};
+}
+
+PatternLattice::NodeId PatternLattice::find(const Handle& pattern) const
+{
+	auto it = _index.find(pattern->get_hash());
+	if (it != _index.end())
+		for (NodeId node : it->second)
+			if (content_eq(_nodes[node].pattern, pattern))
+				return node;
+	return no_node;
+}
+
+void PatternLattice::add_edge(NodeId parent, NodeId child)
+{
+	if (parent == no_node)
+		return;
+
+	for (EdgeId e = _nodes[child].first_parent; e != no_edge; e = _edges[e].next)
+		if (_edges[e].node == parent)
+			return;
+
+	append_edge(_nodes[parent].first_child, _nodes[parent].last_child, child);
+	append_edge(_nodes[child].first_parent, _nodes[child].last_parent, parent);
+}
+
+const Handle& PatternLattice::pattern(NodeId node) const
+{
+	return _nodes[node].pattern;
+}
+
+std::vector<PatternLattice::NodeId> PatternLattice::children(NodeId node) const
+{
+	return edge_nodes(_nodes[node].first_child);
+}
+
+std::vector<PatternLattice::NodeId> PatternLattice::parents(NodeId node) const
+{
+	return edge_nodes(_nodes[node].first_parent);
+}
+
+std::vector<PatternLattice::NodeId> PatternLattice::roots() const
+{
+	std::vector<NodeId> rts;
+	for (NodeId node = 0; node < _nodes.size(); node++)
+		if (_nodes[node].first_parent == no_edge)
+			rts.push_back(node);
+	return rts;
+}
+
+HandleSeq PatternLattice::patterns() const
+{
+	HandleSeq pats;
+	pats.reserve(_nodes.size());
+	for (const Node& node : _nodes)
+		pats.push_back(node.pattern);
+	return pats;
+}
+
+size_t PatternLattice::size() const
+{
+	return _nodes.size();
+}
+
+size_t PatternLattice::n_edges() const
+{
+	// Each edge is recorded once as child and once as parent
+	return _edges.size() / 2;
+}
+
+bool PatternLattice::empty() const
+{
+	return _nodes.empty();
+}
+
+void PatternLattice::clear()
+{
+	_nodes.clear();
+	_edges.clear();
+	_index.clear();
+}
+
+HandleTree PatternLattice::to_tree() const
+{
+	HandleTree tree;
+	for (NodeId root : roots())
+		to_tree(root, tree, tree.insert(tree.end(), pattern(root)));
+	return tree;
+}
+
+void PatternLattice::append_edge(EdgeId& first, EdgeId& last, NodeId node)
+{
+	EdgeId e = _edges.size();
+	_edges.push_back({node, no_edge});
+	if (last == no_edge)
+		first = e;
+	else
+		_edges[last].next = e;
+	last = e;
+}
+
+std::vector<PatternLattice::NodeId> PatternLattice::edge_nodes(EdgeId first) const
+{
+	std::vector<NodeId> nodes;
+	for (EdgeId e = first; e != no_edge; e = _edges[e].next)
+		nodes.push_back(_edges[e].node);
+	return nodes;
+}
+
+void PatternLattice::to_tree(NodeId node, HandleTree& tree,
+                             HandleTree::iterator it) const
+{
+	for (NodeId child : children(node))
+		to_tree(child, tree, tree.append_child(it, pattern(child)));
+}
+
+std::string oc_to_string(const PatternLattice& pl, const std::string& indent)
+{
+	std::stringstream ss;
+	ss << indent << "size = " << pl.size()
+	   << ", edges = " << pl.n_edges();
+	for (PatternLattice::NodeId node = 0; node < pl.size(); node++) {
+		ss << std::endl << indent << "pattern[" << node << "]:" << std::endl
+		   << oc_to_string(pl.pattern(node), indent + OC_TO_STRING_INDENT);
+		std::vector<PatternLattice::NodeId> children = pl.children(node);
+		if (not children.empty()) {
+			ss << std::endl << indent << "children[" << node << "]:";
+			for (PatternLattice::NodeId child : children)
+				ss << " " << child;
+		}
+	}
+	return ss.str();
+}
+
+} // ~namespace opencog
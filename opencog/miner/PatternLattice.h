@@ -0,0 +1,165 @@
+/*
+ * PatternLattice.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_PATTERNLATTICE_H_
+#define OPENCOG_PATTERNLATTICE_H_
+
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <opencog/util/empty_string.h>
+#include <opencog/atoms/base/Handle.h>
+
+#include "HandleTree.h"
+
+namespace opencog
+{
+
+/**
+ * Lattice of patterns linked by specialization relationships (the
+ * children of a pattern are specializations of it). Unlike
+ * HandleTree, a pattern appears only once and can have multiple
+ * parents, making it a directed acyclic graph.
+ *
+ * Nodes and edges are stored in two flat arenas, nodes are referred
+ * to by their index in the node arena, and the children (resp.
+ * parents) of a node form a linked list in the edge arena, so that
+ * adding a node or an edge is an amortized constant time append.
+ *
+ * Patterns are indexed by content, so that inserting a pattern
+ * already in the lattice returns its existing node.
+ */
+class PatternLattice
+{
+public:
+	typedef unsigned NodeId;
+
+	// Id of no node, used as parent of the roots
+	static const NodeId no_node = std::numeric_limits<NodeId>::max();
+
+	/**
+	 * Insert pattern, if not already in the lattice. Return its node
+	 * and whether it has been inserted.
+	 */
+	std::pair<NodeId, bool> insert(const Handle& pattern);
+
+	/**
+	 * Return the node of pattern, or no_node if not in the lattice.
+	 */
+	NodeId find(const Handle& pattern) const;
+
+	/**
+	 * Add an edge from parent to child, unless it already exists. If
+	 * parent is no_node, then do nothing, child is simply a root if it
+	 * has no other parent.
+	 *
+	 * Checking for an existing edge takes time linear in the number of
+	 * parents of child, which remains small in practice.
+	 */
+	void add_edge(NodeId parent, NodeId child);
+
+	/**
+	 * Return the pattern of a node.
+	 */
+	const Handle& pattern(NodeId node) const;
+
+	/**
+	 * Return the children (resp. parents) of a node, in order of
+	 * insertion.
+	 */
+	std::vector<NodeId> children(NodeId node) const;
+	std::vector<NodeId> parents(NodeId node) const;
+
+	/**
+	 * Return the nodes without parents, in order of insertion.
+	 */
+	std::vector<NodeId> roots() const;
+
+	/**
+	 * Return all patterns, in order of insertion.
+	 */
+	HandleSeq patterns() const;
+
+	/**
+	 * Return the number of nodes (resp. edges).
+	 */
+	size_t size() const;
+	size_t n_edges() const;
+
+	bool empty() const;
+	void clear();
+
+	/**
+	 * Unfold the lattice into a forest, starting from its roots. A
+	 * pattern with multiple parents appears under each of them, thus
+	 * the forest can be much larger than the lattice.
+	 */
+	HandleTree to_tree() const;
+
+private:
+	typedef unsigned EdgeId;
+	static const EdgeId no_edge = std::numeric_limits<EdgeId>::max();
+
+	struct Node
+	{
+		Handle pattern;
+		EdgeId first_child;
+		EdgeId last_child;
+		EdgeId first_parent;
+		EdgeId last_parent;
+	};
+
+	struct Edge
+	{
+		NodeId node;
+		EdgeId next;
+	};
+
+	/**
+	 * Append to a linked list of edges, given its first and last
+	 * edges, an edge to node.
+	 */
+	void append_edge(EdgeId& first, EdgeId& last, NodeId node);
+
+	/**
+	 * Return the nodes of a linked list of edges starting at first.
+	 */
+	std::vector<NodeId> edge_nodes(EdgeId first) const;
+
+	/**
+	 * Append the unfolding of node to the given position of a forest.
+	 */
+	void to_tree(NodeId node, HandleTree& tree, HandleTree::iterator it) const;
+
+	std::vector<Node> _nodes;
+	std::vector<Edge> _edges;
+
+	// Nodes indexed by the content hash of their patterns
+	std::unordered_map<ContentHash, std::vector<NodeId>> _index;
+};
+
+std::string oc_to_string(const PatternLattice& pl,
+                         const std::string& indent=empty_string);
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_PATTERNLATTICE_H_ */
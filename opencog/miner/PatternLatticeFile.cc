@@ -0,0 +1,453 @@
+/*
+ * PatternLatticeFile.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "PatternLatticeFile.h"
+#include "MinerUtils.h"
+#include "Surprisingness.h"
+
+#include <opencog/util/exceptions.h>
+#include <opencog/atoms/atom_types/NameServer.h>
+#include <opencog/atoms/base/Atom.h>
+#include <opencog/atoms/truthvalue/SimpleTruthValue.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace opencog
+{
+
+namespace
+{
+
+const char file_magic[8] = {'O', 'C', 'P', 'L', 'A', 'T', '\0', '\0'};
+const uint32_t file_version = 1;
+const uint32_t file_byte_order = 0x01020304;
+
+struct FileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t n_types;
+	uint32_t n_atoms;
+	uint32_t n_outgoings;
+	uint32_t n_nodes;
+	uint32_t n_edges;
+	uint32_t padding;
+	uint64_t types_offset;
+	uint64_t atoms_offset;
+	uint64_t outgoings_offset;
+	uint64_t nodes_offset;
+	uint64_t edges_offset;
+	uint64_t strings_offset;
+	uint64_t strings_size;
+};
+
+struct TypeRecord
+{
+	uint64_t name_offset;
+	uint32_t name_size;
+	uint32_t padding;
+};
+
+/**
+ * For a node, offset and size are those of its name in the strings,
+ * for a link, those of its outgoing in the outgoings.
+ */
+struct AtomRecord
+{
+	uint32_t type;
+	uint32_t size;
+	uint64_t offset;
+};
+
+uint64_t align8(uint64_t offset)
+{
+	return (offset + 7) & ~(uint64_t)7;
+}
+
+/**
+ * Tables of atoms and types of a file under construction. Each atom
+ * is interned once, after its outgoing.
+ */
+class AtomTable
+{
+public:
+	uint32_t intern(const Handle& h);
+
+	std::vector<TypeRecord> types;
+	std::vector<AtomRecord> atoms;
+	std::vector<uint32_t> outgoings;
+	std::string strings;
+
+private:
+	uint32_t intern_type(Type t);
+
+	std::unordered_map<Handle, uint32_t> _atom_indices;
+	std::map<Type, uint32_t> _type_indices;
+};
+
+uint32_t AtomTable::intern(const Handle& h)
+{
+	auto it = _atom_indices.find(h);
+	if (it != _atom_indices.end())
+		return it->second;
+
+	AtomRecord record{intern_type(h->get_type()), 0, 0};
+	if (h->is_node()) {
+		const std::string& name = h->get_name();
+		record.size = name.size();
+		record.offset = strings.size();
+		strings += name;
+	} else {
+		std::vector<uint32_t> outgoing;
+		for (const Handle& child : h->getOutgoingSet())
+			outgoing.push_back(intern(child));
+		record.size = outgoing.size();
+		record.offset = outgoings.size();
+		outgoings.insert(outgoings.end(), outgoing.begin(), outgoing.end());
+	}
+
+	uint32_t index = atoms.size();
+	atoms.push_back(record);
+	_atom_indices[h] = index;
+	return index;
+}
+
+uint32_t AtomTable::intern_type(Type t)
+{
+	auto it = _type_indices.find(t);
+	if (it != _type_indices.end())
+		return it->second;
+
+	const std::string& name = nameserver().getTypeName(t);
+	uint32_t index = types.size();
+	types.push_back({strings.size(), (uint32_t)name.size(), 0});
+	strings += name;
+	_type_indices[t] = index;
+	return index;
+}
+
+double mean_or_nan(const TruthValuePtr& tv)
+{
+	return tv ? tv->get_mean() : std::numeric_limits<double>::quiet_NaN();
+}
+
+double confidence_or_nan(const TruthValuePtr& tv)
+{
+	return tv ? tv->get_confidence() : std::numeric_limits<double>::quiet_NaN();
+}
+
+} // ~namespace
+
+void PatternLatticeFile::save(const PatternLattice& lattice,
+                              const std::string& filename)
+{
+	// Build all sections in memory
+	AtomTable table;
+	std::vector<NodeRecord> nodes;
+	std::vector<uint32_t> edges;
+	nodes.reserve(lattice.size());
+	for (NodeId node = 0; node < lattice.size(); node++) {
+		const Handle& pattern = lattice.pattern(node);
+		std::vector<NodeId> children = lattice.children(node);
+		double support = MinerUtils::get_support(pattern);
+		double cap = MinerUtils::get_support_cap(pattern);
+		TruthValuePtr emp_tv = Surprisingness::get_emp_tv(pattern),
+			est_tv = Surprisingness::get_ji_tv_est(pattern);
+		nodes.push_back({table.intern(pattern),
+		                 (uint32_t)edges.size(),
+		                 (uint32_t)children.size(),
+		                 // A cap of UINT_MAX or more is as good as none
+		                 cap < UINT32_MAX ? (uint32_t)cap + 1 : 0,
+		                 support < 0 ? std::numeric_limits<double>::quiet_NaN()
+		                 : support,
+		                 mean_or_nan(emp_tv),
+		                 confidence_or_nan(emp_tv),
+		                 mean_or_nan(est_tv),
+		                 confidence_or_nan(est_tv),
+		                 Surprisingness::get_surp(pattern)});
+		edges.insert(edges.end(), children.begin(), children.end());
+	}
+
+	// Lay out the sections
+	FileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, file_magic, sizeof(file_magic));
+	header.version = file_version;
+	header.byte_order = file_byte_order;
+	header.n_types = table.types.size();
+	header.n_atoms = table.atoms.size();
+	header.n_outgoings = table.outgoings.size();
+	header.n_nodes = nodes.size();
+	header.n_edges = edges.size();
+	uint64_t offset = sizeof(FileHeader);
+	auto place = [&](uint64_t size) {
+		uint64_t section_offset = align8(offset);
+		offset = section_offset + size;
+		return section_offset;
+	};
+	header.types_offset = place(table.types.size() * sizeof(TypeRecord));
+	header.atoms_offset = place(table.atoms.size() * sizeof(AtomRecord));
+	header.outgoings_offset = place(table.outgoings.size() * sizeof(uint32_t));
+	header.nodes_offset = place(nodes.size() * sizeof(NodeRecord));
+	header.edges_offset = place(edges.size() * sizeof(uint32_t));
+	header.strings_offset = place(table.strings.size());
+	header.strings_size = table.strings.size();
+
+	// Write them
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	if (not out)
+		throw RuntimeException(TRACE_INFO, "Cannot write pattern lattice file %s",
+		                       filename.c_str());
+	uint64_t written = 0;
+	auto write = [&](uint64_t section_offset, const void* data, uint64_t size) {
+		static const char zeros[8] = {0};
+		out.write(zeros, section_offset - written);
+		out.write(static_cast<const char*>(data), size);
+		written = section_offset + size;
+	};
+	write(0, &header, sizeof(header));
+	write(header.types_offset, table.types.data(),
+	      table.types.size() * sizeof(TypeRecord));
+	write(header.atoms_offset, table.atoms.data(),
+	      table.atoms.size() * sizeof(AtomRecord));
+	write(header.outgoings_offset, table.outgoings.data(),
+	      table.outgoings.size() * sizeof(uint32_t));
+	write(header.nodes_offset, nodes.data(), nodes.size() * sizeof(NodeRecord));
+	write(header.edges_offset, edges.data(), edges.size() * sizeof(uint32_t));
+	write(header.strings_offset, table.strings.data(), table.strings.size());
+	out.close();
+	if (not out)
+		throw RuntimeException(TRACE_INFO, "Cannot write pattern lattice file %s",
+		                       filename.c_str());
+}
+
+PatternLatticeFile::PatternLatticeFile(const std::string& filename)
+	: _filename(filename), _fd(-1), _data(nullptr), _size(0)
+{
+	_fd = open(filename.c_str(), O_RDONLY);
+	if (_fd < 0)
+		throw RuntimeException(TRACE_INFO, "Cannot open pattern lattice file %s",
+		                       filename.c_str());
+
+	struct stat st;
+	if (fstat(_fd, &st) < 0 or (size_t)st.st_size < sizeof(FileHeader)) {
+		close(_fd);
+		throw RuntimeException(TRACE_INFO, "Invalid pattern lattice file %s",
+		                       filename.c_str());
+	}
+	_size = st.st_size;
+
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+	if (data == MAP_FAILED) {
+		close(_fd);
+		throw RuntimeException(TRACE_INFO, "Cannot map pattern lattice file %s",
+		                       filename.c_str());
+	}
+	_data = static_cast<const char*>(data);
+
+	try {
+		check();
+	} catch (...) {
+		munmap(const_cast<char*>(_data), _size);
+		close(_fd);
+		throw;
+	}
+}
+
+PatternLatticeFile::~PatternLatticeFile()
+{
+	munmap(const_cast<char*>(_data), _size);
+	close(_fd);
+}
+
+size_t PatternLatticeFile::size() const
+{
+	return at<FileHeader>(0)->n_nodes;
+}
+
+size_t PatternLatticeFile::n_edges() const
+{
+	return at<FileHeader>(0)->n_edges;
+}
+
+const PatternLatticeFile::NodeRecord& PatternLatticeFile::node(NodeId node) const
+{
+	const FileHeader& header = *at<FileHeader>(0);
+	OC_ASSERT(node < header.n_nodes);
+	const NodeRecord& record = at<NodeRecord>(header.nodes_offset)[node];
+	if (header.n_atoms <= record.atom or
+	    header.n_edges < (uint64_t)record.children_begin + record.n_children)
+		throw RuntimeException(TRACE_INFO, "Invalid node %u in %s",
+		                       node, _filename.c_str());
+	return record;
+}
+
+const uint32_t* PatternLatticeFile::children(NodeId node) const
+{
+	const FileHeader& header = *at<FileHeader>(0);
+	return at<uint32_t>(header.edges_offset) + this->node(node).children_begin;
+}
+
+Handle PatternLatticeFile::pattern(NodeId node, AtomSpace& as) const
+{
+	const NodeRecord& record = this->node(node);
+	Handle pattern = atom(record.atom, as);
+	if (not std::isnan(record.support))
+		MinerUtils::set_support(pattern, record.support,
+		                        record.support_cap == 0 ?
+		                        std::numeric_limits<double>::infinity()
+		                        : record.support_cap - 1.0);
+	if (not std::isnan(record.emp_strength))
+		Surprisingness::set_emp_tv(pattern,
+			createSimpleTruthValue(record.emp_strength, record.emp_confidence));
+	if (not std::isnan(record.est_strength))
+		Surprisingness::set_ji_tv_est(pattern,
+			createSimpleTruthValue(record.est_strength, record.est_confidence));
+	if (not std::isnan(record.surprisingness))
+		Surprisingness::set_surp(pattern, record.surprisingness);
+	return pattern;
+}
+
+PatternLattice PatternLatticeFile::load(AtomSpace& as) const
+{
+	PatternLattice lattice;
+	std::vector<PatternLattice::NodeId> ids;
+	ids.reserve(size());
+	for (NodeId node = 0; node < size(); node++)
+		ids.push_back(lattice.insert(pattern(node, as)).first);
+	for (NodeId node = 0; node < size(); node++) {
+		const uint32_t* chn = children(node);
+		for (uint32_t i = 0; i < this->node(node).n_children; i++) {
+			if (size() <= chn[i])
+				throw RuntimeException(TRACE_INFO, "Invalid edge in %s",
+				                       _filename.c_str());
+			lattice.add_edge(ids[node], ids[chn[i]]);
+		}
+	}
+	return lattice;
+}
+
+void PatternLatticeFile::clear_memo()
+{
+	_atoms.clear();
+}
+
+void PatternLatticeFile::check() const
+{
+	const FileHeader& header = *at<FileHeader>(0);
+	if (std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0)
+		throw RuntimeException(TRACE_INFO, "%s is not a pattern lattice file",
+		                       _filename.c_str());
+	if (header.byte_order != file_byte_order)
+		throw RuntimeException(TRACE_INFO, "%s has been written with another "
+		                       "byte order", _filename.c_str());
+	if (header.version != file_version)
+		throw RuntimeException(TRACE_INFO, "%s has unsupported version %u",
+		                       _filename.c_str(), header.version);
+
+	auto fits = [&](uint64_t offset, uint64_t count, uint64_t size) {
+		return offset % 8 == 0 and offset <= _size
+			and count <= (_size - offset) / size;
+	};
+	if (not fits(header.types_offset, header.n_types, sizeof(TypeRecord)) or
+	    not fits(header.atoms_offset, header.n_atoms, sizeof(AtomRecord)) or
+	    not fits(header.outgoings_offset, header.n_outgoings, sizeof(uint32_t)) or
+	    not fits(header.nodes_offset, header.n_nodes, sizeof(NodeRecord)) or
+	    not fits(header.edges_offset, header.n_edges, sizeof(uint32_t)) or
+	    not fits(header.strings_offset, header.strings_size, 1))
+		throw RuntimeException(TRACE_INFO, "%s is truncated or corrupted",
+		                       _filename.c_str());
+}
+
+Type PatternLatticeFile::type(uint32_t index) const
+{
+	const FileHeader& header = *at<FileHeader>(0);
+	if (_types.empty())
+		_types.resize(header.n_types, NOTYPE);
+	if (header.n_types <= index)
+		throw RuntimeException(TRACE_INFO, "Invalid type %u in %s",
+		                       index, _filename.c_str());
+
+	if (_types[index] == NOTYPE) {
+		const TypeRecord& record = at<TypeRecord>(header.types_offset)[index];
+		if (header.strings_size < record.name_offset + record.name_size)
+			throw RuntimeException(TRACE_INFO, "Invalid type %u in %s",
+			                       index, _filename.c_str());
+		std::string name(at<char>(header.strings_offset) + record.name_offset,
+		                 record.name_size);
+		_types[index] = nameserver().getType(name);
+		if (_types[index] == NOTYPE)
+			throw RuntimeException(TRACE_INFO, "Unknown type %s in %s",
+			                       name.c_str(), _filename.c_str());
+	}
+	return _types[index];
+}
+
+Handle PatternLatticeFile::atom(uint32_t index, AtomSpace& as) const
+{
+	const FileHeader& header = *at<FileHeader>(0);
+	if (_atoms.empty())
+		_atoms.resize(header.n_atoms);
+	if (_atoms[index] and _atoms[index]->getAtomSpace() == &as)
+		return _atoms[index];
+
+	const AtomRecord& record = at<AtomRecord>(header.atoms_offset)[index];
+	Type t = type(record.type);
+	if (nameserver().isNode(t)) {
+		if (header.strings_size < record.offset + record.size)
+			throw RuntimeException(TRACE_INFO, "Invalid atom %u in %s",
+			                       index, _filename.c_str());
+		std::string name(at<char>(header.strings_offset) + record.offset,
+		                 record.size);
+		_atoms[index] = as.add_node(t, std::move(name));
+	} else {
+		if (header.n_outgoings < record.offset + record.size)
+			throw RuntimeException(TRACE_INFO, "Invalid atom %u in %s",
+			                       index, _filename.c_str());
+		const uint32_t* outgoing = at<uint32_t>(header.outgoings_offset)
+			+ record.offset;
+		HandleSeq hs;
+		hs.reserve(record.size);
+		for (uint32_t i = 0; i < record.size; i++) {
+			// Outgoings are interned before the links containing
+			// them, which also rules out cycles.
+			if (index <= outgoing[i])
+				throw RuntimeException(TRACE_INFO, "Invalid atom %u in %s",
+				                       index, _filename.c_str());
+			hs.push_back(atom(outgoing[i], as));
+		}
+		_atoms[index] = as.add_link(t, std::move(hs));
+	}
+	return _atoms[index];
+}
+
+} // ~namespace opencog
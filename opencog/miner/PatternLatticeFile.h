@@ -0,0 +1,186 @@
+/*
+ * PatternLatticeFile.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_PATTERNLATTICEFILE_H_
+#define OPENCOG_PATTERNLATTICEFILE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atomspace/AtomSpace.h>
+
+#include "PatternLattice.h"
+
+namespace opencog
+{
+
+/**
+ * Compact binary file of a pattern lattice, read through a read-only
+ * memory mapping so that opening a file, even of millions of
+ * patterns, does not copy or parse anything. Patterns are only
+ * turned back into atoms when requested.
+ *
+ * The file consists of a header followed by these sections, each
+ * 8-byte aligned:
+ *
+ * 1. the type table, the names of the atom types in use, so that
+ *    files do not depend on the type numbering of a given build;
+ * 2. the atom table, every atom appearing in a pattern, interned
+ *    once, outgoings before the links containing them;
+ * 3. the outgoings of the links, as indices in the atom table;
+ * 4. the pattern nodes, with their support (and the cap it has been
+ *    counted up to, see MinerUtils::set_support, plus one, or 0 if
+ *    none), empirical and estimated truth values and surprisingness
+ *    (NaN when unknown);
+ * 5. the specialization edges, the children of each node stored
+ *    contiguously;
+ * 6. the strings, names of types and nodes.
+ *
+ * Integers and floats are stored in the byte order of the machine
+ * that wrote the file, which is checked when opening it.
+ *
+ * A reader is not thread safe, even through its const methods, as
+ * pattern and load memoize the atoms they add.
+ */
+class PatternLatticeFile
+{
+public:
+	typedef PatternLattice::NodeId NodeId;
+
+	/**
+	 * Pattern node as stored in the file
+	 */
+	struct NodeRecord
+	{
+		uint32_t atom;
+		uint32_t children_begin;
+		uint32_t n_children;
+		uint32_t support_cap;
+		double support;
+		double emp_strength;
+		double emp_confidence;
+		double est_strength;
+		double est_confidence;
+		double surprisingness;
+	};
+
+	/**
+	 * Write lattice to filename. The support, empirical and estimated
+	 * truth values and surprisingness of each pattern are taken from
+	 * its values (see MinerUtils::get_support,
+	 * Surprisingness::get_emp_tv, Surprisingness::get_ji_tv_est and
+	 * Surprisingness::get_surp).
+	 *
+	 * Throw a RuntimeException if the file cannot be written.
+	 */
+	static void save(const PatternLattice& lattice, const std::string& filename);
+
+	/**
+	 * Map filename in memory. Throw a RuntimeException if it cannot
+	 * be opened or is not a valid pattern lattice file.
+	 */
+	explicit PatternLatticeFile(const std::string& filename);
+	~PatternLatticeFile();
+
+	PatternLatticeFile(const PatternLatticeFile&) = delete;
+	PatternLatticeFile& operator=(const PatternLatticeFile&) = delete;
+
+	/**
+	 * Return the number of pattern nodes (resp. edges).
+	 */
+	size_t size() const;
+	size_t n_edges() const;
+
+	/**
+	 * Return the record of a node, pointing directly into the file.
+	 */
+	const NodeRecord& node(NodeId node) const;
+
+	/**
+	 * Return the children of a node, pointing directly into the
+	 * file, and their number (see NodeRecord::n_children).
+	 */
+	const uint32_t* children(NodeId node) const;
+
+	/**
+	 * Add the pattern of a node to as, along with its values, and
+	 * return it. Atoms already added are memoized, so that loading
+	 * patterns sharing subatoms one after the other does not rebuild
+	 * them. A memoized atom is only reused if it is still in as.
+	 */
+	Handle pattern(NodeId node, AtomSpace& as) const;
+
+	/**
+	 * Add all patterns to as, as pattern does, and return the lattice
+	 * they form.
+	 */
+	PatternLattice load(AtomSpace& as) const;
+
+	/**
+	 * Forget the memoized atoms, releasing them.
+	 */
+	void clear_memo();
+
+private:
+	/**
+	 * Check that the header is valid and that all sections fit in
+	 * the file, and throw a RuntimeException otherwise. Records are
+	 * checked as they are read.
+	 */
+	void check() const;
+
+	/**
+	 * Return the type of the given index in the type table.
+	 */
+	Type type(uint32_t index) const;
+
+	/**
+	 * Add the atom of the given index in the atom table to as.
+	 */
+	Handle atom(uint32_t index, AtomSpace& as) const;
+
+	/**
+	 * Return a pointer to the given offset of the file, viewed as an
+	 * array of T.
+	 */
+	template<typename T>
+	const T* at(uint64_t offset) const
+	{
+		return reinterpret_cast<const T*>(_data + offset);
+	}
+
+	std::string _filename;
+	int _fd;
+	const char* _data;
+	size_t _size;
+
+	// Atoms added so far, by index in the atom table. Each is checked
+	// to belong to the atomspace at hand before being reused, rather
+	// than remembering the address of that atomspace, which may be
+	// reused by another one once destroyed.
+	mutable std::vector<Handle> _atoms;
+	mutable std::vector<Type> _types;
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_PATTERNLATTICEFILE_H_ */
@@ -25,9 +25,10 @@
 
 #include "MinerUtils.h"
 #include "MinerLogger.h"
+#include "MinerStats.h"
+#include "MinerTrace.h"
 
 #include <opencog/util/Logger.h>
-#include <opencog/util/lazy_random_selector.h>
 #include <opencog/util/random.h>
 #include <opencog/util/dorepeat.h>
 #include <opencog/util/algorithm.h>
@@ -37,6 +38,7 @@
 #include <opencog/atoms/core/FindUtils.h>
 #include <opencog/atoms/core/LambdaLink.h>
 #include <opencog/atoms/truthvalue/SimpleTruthValue.h>
+#include <opencog/atoms/value/FloatValue.h>
 #include <opencog/ure/BetaDistribution.h>
 
 #include <boost/range/adaptor/transformed.hpp>
@@ -44,10 +46,19 @@
 #include <boost/range/algorithm/min_element.hpp>
 #include <boost/range/algorithm/sort.hpp>
 #include <boost/range/numeric.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/math/special_functions/binomial.hpp>
+#include <boost/math/special_functions/beta.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <exception>
 #include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
 #include <limits>
 
 namespace opencog {
@@ -93,12 +104,20 @@ double Surprisingness::isurp_old(const Handle& pattern,
 double Surprisingness::isurp(const Handle& pattern,
                              const HandleSeq& db,
                              bool normalize,
-                             double db_ratio)
+                             double db_ratio,
+                             size_t db_fp)
 {
+	MinerStats::Timer timer(MinerStats::ISurprisingness);
+	MinerTrace::Scope trace("isurp", pattern, db.size());
+	if (db_fp == 0)
+		db_fp = db_fingerprint(db);
+
 	// Calculate the probability estimate of each partition based on
 	// independent assumption of between each partition block, taking
 	// into account the linkage probability.
-	auto [emin, emax] = ji_prob_est_interval(pattern, db, db_ratio);
+	size_t n_partitions = 0;
+	auto [emin, emax] = ji_prob_est_interval(pattern, db, db_ratio, db_fp,
+	                                         &n_partitions);
 
 	// Calculate the empirical probability of pattern, using
 	// boostrapping if necessary
@@ -107,9 +126,67 @@ double Surprisingness::isurp(const Handle& pattern,
 	// Calculate the I-Surprisingness, normalized if requested.
 	double dst = dst_from_interval(emin, emax, emp);
 	double maxprb = std::max(emp, emax);
+	trace.rows(n_partitions);
 	return std::min(normalize ? dst / maxprb : dst, 1.0);
 }
 
+std::vector<double> Surprisingness::isurp_batch(const HandleSeq& patterns,
+                                                const HandleSeq& db,
+                                                bool normalize,
+                                                double db_ratio,
+                                                unsigned jobs)
+{
+	// Process smaller patterns first, as they are likely subpatterns
+	// of the larger ones.
+	std::vector<size_t> order(patterns.size());
+	std::vector<unsigned> ncs(patterns.size());
+	for (size_t i = 0; i < patterns.size(); i++) {
+		order[i] = i;
+		ncs[i] = MinerUtils::n_conjuncts(patterns[i]);
+	}
+	std::stable_sort(order.begin(), order.end(),
+	                 [&](size_t l, size_t r) { return ncs[l] < ncs[r]; });
+
+	// Fingerprint db once for the whole batch, rather than on each
+	// lookup of the values memo.
+	size_t db_fp = db_fingerprint(db);
+
+	// Each thread picks up the next pattern to process till there is
+	// none left.
+	std::vector<double> results(patterns.size());
+	std::atomic<size_t> next(0);
+	std::exception_ptr error;
+	std::mutex error_mtx;
+	auto worker = [&]() {
+		try {
+			for (size_t i = next++; i < order.size(); i = next++)
+				results[order[i]] = isurp(patterns[order[i]], db,
+				                          normalize, db_ratio, db_fp);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(error_mtx);
+			error = std::current_exception();
+			next = order.size();
+		}
+	};
+
+	jobs = std::max(1U, std::min(jobs, (unsigned)patterns.size()));
+	std::vector<std::thread> threads;
+	for (unsigned j = 1; j < jobs; j++)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+
+	// The values memo is only valid for db, free it, as well as the
+	// abstraction memos
+	clear_values_mem();
+	clear_abstraction_mem();
+
+	if (error)
+		std::rethrow_exception(error);
+	return results;
+}
+
 double Surprisingness::dst_from_interval(double l, double u, double v)
 {
 	return (u < v ? v - u : (v < l ? l - v : 0.0));
@@ -161,8 +238,98 @@ HandleCounter Surprisingness::value_distribution(const HandleSeq& block,
                                                  const Handle& var,
                                                  const HandleSeq& db)
 {
+	Valuations vs(MinerUtils::mk_pattern_no_vardecl(block), db);
+	return to_distribution(vs.values(var));
+}
+
+// Key of the values_mem memo
+struct ValuesMemKey
+{
+	Handle body;
+	Handle var;
+	size_t db_fp;
+
+	bool operator==(const ValuesMemKey& other) const
+	{
+		return db_fp == other.db_fp
+			and content_eq(var, other.var)
+			and content_eq(body, other.body);
+	}
+};
+
+struct ValuesMemKeyHash
+{
+	size_t operator()(const ValuesMemKey& key) const
+	{
+		size_t seed = key.db_fp;
+		boost::hash_combine(seed, key.body->get_hash());
+		boost::hash_combine(seed, key.var->get_hash());
+		return seed;
+	}
+};
+
+typedef std::unordered_map<ValuesMemKey, HandleUCounter, ValuesMemKeyHash> ValuesMem;
+
+static ValuesMem values_memo;
+static std::mutex values_memo_mtx;
+
+unsigned Surprisingness::value_count_mem(const HandleSeq& block,
+                                         const Handle& var,
+                                         const HandleSeq& db,
+                                         size_t db_fp)
+{
+	return values_mem(block, var, db, db_fp).keys().size();
+}
+
+HandleCounter Surprisingness::value_distribution_mem(const HandleSeq& block,
+                                                     const Handle& var,
+                                                     const HandleSeq& db,
+                                                     size_t db_fp)
+{
+	return to_distribution(values_mem(block, var, db, db_fp));
+}
+
+HandleUCounter Surprisingness::values_mem(const HandleSeq& block,
+                                          const Handle& var,
+                                          const HandleSeq& db,
+                                          size_t db_fp)
+{
+	if (db_fp == 0)
+		db_fp = db_fingerprint(db);
+	ValuesMemKey key{MinerUtils::mk_body(block), var, db_fp};
+	{
+		std::lock_guard<std::mutex> lock(values_memo_mtx);
+		auto it = values_memo.find(key);
+		if (it != values_memo.end()) {
+			MinerStats::hit(MinerStats::ValuesMem);
+			return it->second;
+		}
+	}
+	MinerStats::miss(MinerStats::ValuesMem);
+
+	// Not memoized yet, calculate outside of the lock so that other
+	// threads are not held back by the pattern matcher.
 	Valuations vs(MinerUtils::mk_pattern_no_vardecl(block), db);
 	HandleUCounter values = vs.values(var);
+
+	std::lock_guard<std::mutex> lock(values_memo_mtx);
+	values_memo.emplace(key, values);
+	return values;
+}
+
+void Surprisingness::clear_values_mem()
+{
+	std::lock_guard<std::mutex> lock(values_memo_mtx);
+	values_memo.clear();
+}
+
+size_t Surprisingness::db_fingerprint(const HandleSeq& db)
+{
+	return MinerUtils::db_fingerprint(db);
+}
+
+HandleCounter Surprisingness::to_distribution(const HandleUCounter& values)
+{
 	HandleCounter dist;
 	double total = values.total_count();
 	for (const auto& v : values)
@@ -230,6 +397,16 @@ double Surprisingness::emp_prob_subsmp(const Handle& pattern,
 	                subsmp(db, subsize) : db);
 }
 
+double Surprisingness::emp_prob_subsmp(const Handle& pattern,
+                                       const HandleSeq& db,
+                                       unsigned subsize,
+                                       std::mt19937& rng)
+{
+	return emp_prob(pattern,
+	                subsize < db.size() ?
+	                subsmp(db, subsize, rng) : db);
+}
+
 TruthValuePtr Surprisingness::emp_tv(const Handle& pattern, const HandleSeq& db)
 {
 	double ucount = universe_count(pattern, db);
@@ -264,15 +441,26 @@ TruthValuePtr Surprisingness::emp_tv_subsmp(const Handle& pattern,
 	              subsmp(db, subsize) : db);
 }
 
+TruthValuePtr Surprisingness::emp_tv_subsmp(const Handle& pattern,
+                                            const HandleSeq& db,
+                                            unsigned subsize,
+                                            std::mt19937& rng)
+{
+	return emp_tv(pattern,
+	              subsize < db.size() ?
+	              subsmp(db, subsize, rng) : db);
+}
+
 double Surprisingness::emp_prob_bs(const Handle& pattern,
                                    const HandleSeq& db,
                                    unsigned n_resample,
                                    unsigned subsize)
 {
 	if (subsize < db.size()) {
+		std::mt19937 rng = subsmp_rng(pattern);
 		std::vector<double> essprobs;
 		dorepeat(n_resample)
-			essprobs.push_back(emp_prob_subsmp(pattern, db, subsize));
+			essprobs.push_back(emp_prob_subsmp(pattern, db, subsize, rng));
 		return avrg(essprobs);
 	} else {
 		return emp_prob(pattern, db);
@@ -281,12 +469,13 @@ double Surprisingness::emp_prob_bs(const Handle& pattern,
 
 double Surprisingness::emp_prob_pbs(const Handle& pattern,
                                     const HandleSeq& db,
-                                    double db_ratio)
+                                    double db_ratio,
+                                    size_t db_fp)
 {
 	if (1 < MinerUtils::n_conjuncts(pattern)) {
 		// If there is more than one conjunct, calculate an estimate
 		// first to subsample the db if necessary
-		auto [emin, emax] = ji_prob_est_interval(pattern, db, db_ratio);
+		auto [emin, emax] = ji_prob_est_interval(pattern, db, db_ratio, db_fp);
 		return emp_prob_pbs(pattern, db, emax, db_ratio);
 	} else {
 		// Otherwise, no subsampling is necessary, should be tractable
@@ -338,13 +527,14 @@ double Surprisingness::emp_prob_pbs(const Handle& pattern,
 
 double Surprisingness::emp_prob_pbs_mem(const Handle& pattern,
                                         const HandleSeq& db,
-                                        double db_ratio)
+                                        double db_ratio,
+                                        size_t db_fp)
 {
 	TruthValuePtr etv = get_emp_tv(pattern);
 	if (etv) {
 		return etv->get_mean();
 	}
-	double ep = emp_prob_pbs(pattern, db, db_ratio);
+	double ep = emp_prob_pbs(pattern, db, db_ratio, db_fp);
 	set_emp_prob(pattern, ep);
 	return ep;
 }
@@ -369,9 +559,10 @@ TruthValuePtr Surprisingness::emp_tv_bs(const Handle& pattern,
                                         unsigned subsize)
 {
 	if (subsize < db.size()) {
+		std::mt19937 rng = subsmp_rng(pattern);
 		TruthValueSeq esstvs;
 		dorepeat(n_resample)
-			esstvs.push_back(emp_tv_subsmp(pattern, db, subsize));
+			esstvs.push_back(emp_tv_subsmp(pattern, db, subsize, rng));
 		return avrg_tv(esstvs);
 	} else {
 		TruthValuePtr etv = emp_tv(pattern, db);
@@ -418,6 +609,13 @@ TruthValuePtr Surprisingness::emp_tv_pbs_mem(const Handle& pattern,
 }
 
 HandleSeq Surprisingness::subsmp(const HandleSeq& db, unsigned subsize)
+{
+	std::mt19937 rng(randGen().randint(std::numeric_limits<int>::max()));
+	return subsmp(db, subsize, rng);
+}
+
+HandleSeq Surprisingness::subsmp(const HandleSeq& db, unsigned subsize,
+                                 std::mt19937& rng)
 {
 	unsigned ts = db.size();
 	if (ts/2 <= subsize and subsize < ts) {
@@ -427,23 +625,45 @@ HandleSeq Surprisingness::subsmp(const HandleSeq& db, unsigned subsize)
 		HandleSeq smp_db(db);
 		unsigned i = ts;
 		while (subsize < i) {
-			unsigned rnd_idx = randGen().randint(i);
-			std::swap(smp_db[rnd_idx], smp_db[--i]);
+			std::uniform_int_distribution<unsigned> dist(0, i - 1);
+			std::swap(smp_db[dist(rng)], smp_db[--i]);
 		}
 		smp_db.resize(i);
 		return smp_db;
 	} else if (0 <= subsize and subsize < ts/*/2*/) {
-		// Subsample by randomly adding
+		// Subsample by randomly adding, that is a Fisher-Yates
+		// shuffle of the first subsize indices only, where the
+		// swapped indices are kept in a map rather than a copy of db.
 		HandleSeq smp_db(subsize);
-		lazy_random_selector select(ts);
-		for (size_t i = 0; i < subsize; i++)
-			smp_db[i] = db[select()];
+		std::unordered_map<unsigned, unsigned> swapped;
+		auto at = [&](unsigned k) {
+			auto it = swapped.find(k);
+			return it == swapped.end() ? k : it->second;
+		};
+		for (unsigned i = 0; i < subsize; i++) {
+			std::uniform_int_distribution<unsigned> dist(i, ts - 1);
+			unsigned j = dist(rng);
+			unsigned sj = at(j);
+			swapped[j] = at(i);
+			smp_db[i] = db[sj];
+		}
 		return smp_db;
 	} else {
 		return db;
 	}
 }
 
+std::mt19937 Surprisingness::subsmp_rng(const Handle& pattern)
+{
+	// Seed from the pattern content rather than from the order in
+	// which patterns are evaluated, so that the subsamples of a
+	// pattern, and thus its memoized empirical probability, do not
+	// depend on the number of threads or their scheduling.
+	uint64_t h = pattern->get_hash();
+	std::seed_seq seq{(uint32_t)h, (uint32_t)(h >> 32)};
+	return std::mt19937(seq);
+}
+
 unsigned Surprisingness::subsmp_size(const Handle& pattern,
                                      double db_size,
                                      double support_estimate,
@@ -457,15 +677,24 @@ unsigned Surprisingness::subsmp_size(const Handle& pattern,
 
 std::pair<double, double> Surprisingness::ji_prob_est_interval(const Handle& pattern,
                                                                const HandleSeq& db,
-                                                               double db_ratio)
+                                                               double db_ratio,
+                                                               size_t db_fp,
+                                                               size_t* n_partitions)
 {
+	if (db_fp == 0)
+		db_fp = db_fingerprint(db);
+
 	// Calculate the probability estimate of each partition based on
 	// independent assumption of between each partition block, taking
 	// into account the linkage probability.
+	MinerStats::Timer timer(MinerStats::PartitionEstimates);
 	std::vector<double> estimates;
 	HandleSeqSeqSeq prtns = MinerUtils::partitions_without_pattern(pattern);
+	timer.rows(prtns.size());
+	if (n_partitions)
+		*n_partitions = prtns.size();
 	for (const HandleSeqSeq& partition : prtns) {
-		double jip = ji_prob_est(partition, pattern, db, db_ratio);
+		double jip = ji_prob_est(partition, pattern, db, db_ratio, db_fp);
 		estimates.push_back(jip);
 	}
 	auto mmp = std::minmax_element(estimates.begin(), estimates.end());
@@ -477,7 +706,8 @@ std::pair<double, double> Surprisingness::ji_prob_est_interval(const Handle& pat
 double Surprisingness::ji_prob_est(const HandleSeqSeq& partition,
                                    const Handle& pattern,
                                    const HandleSeq& db,
-                                   double db_ratio)
+                                   double db_ratio,
+                                   size_t db_fp)
 {
 	// Generate subpatterns from blocks (add them in the atomspace to
 	// memoize support calculation)
@@ -488,13 +718,13 @@ double Surprisingness::ji_prob_est(const HandleSeqSeq& partition,
 	// without considering joint variables
 	double p = 1.0;
 	for (const Handle& subpattern : subpatterns) {
-		double empr = emp_prob_pbs_mem(subpattern, db, db_ratio);
+		double empr = emp_prob_pbs_mem(subpattern, db, db_ratio, db_fp);
 		p *= empr;
 	}
 
 	// Calculate the probability that all joint variables take the same
 	// value
-	double eq_p = eq_prob(partition, pattern, db);
+	double eq_p = eq_prob(partition, pattern, db, db_fp);
 	p *= eq_p;
 
 	return p;
@@ -596,20 +826,118 @@ bool Surprisingness::is_strictly_more_abstract(const HandleSeq& l_blk,
 		and MinerUtils::is_blk_more_abstract(l_blk, r_blk, var);
 }
 
+// Key of the abstraction relationship memos
+struct AbstractionMemKey
+{
+	Handle l_body;
+	Handle r_body;
+	Handle var;
+
+	bool operator==(const AbstractionMemKey& other) const
+	{
+		return content_eq(var, other.var)
+			and content_eq(l_body, other.l_body)
+			and content_eq(r_body, other.r_body);
+	}
+};
+
+struct AbstractionMemKeyHash
+{
+	size_t operator()(const AbstractionMemKey& key) const
+	{
+		size_t seed = key.l_body->get_hash();
+		boost::hash_combine(seed, key.r_body->get_hash());
+		boost::hash_combine(seed, key.var->get_hash());
+		return seed;
+	}
+};
+
+typedef std::unordered_map<AbstractionMemKey, bool, AbstractionMemKeyHash> AbstractionMem;
+
+static AbstractionMem more_abstract_memo;
+static AbstractionMem strictly_more_abstract_memo;
+static std::mutex abstraction_memo_mtx;
+
+// Look up key in memo, if missing calculate it with fun, outside of
+// the lock, and memoize it.
+static bool abstraction_mem(AbstractionMem& memo,
+                            const AbstractionMemKey& key,
+                            std::function<bool()> fun)
+{
+	{
+		std::lock_guard<std::mutex> lock(abstraction_memo_mtx);
+		auto it = memo.find(key);
+		if (it != memo.end())
+			return it->second;
+	}
+	bool result = fun();
+	std::lock_guard<std::mutex> lock(abstraction_memo_mtx);
+	memo.emplace(key, result);
+	return result;
+}
+
+bool Surprisingness::is_blk_more_abstract_mem(const HandleSeq& l_blk,
+                                              const HandleSeq& r_blk,
+                                              const Handle& var)
+{
+	AbstractionMemKey key{MinerUtils::mk_body(l_blk),
+	                      MinerUtils::mk_body(r_blk), var};
+	return abstraction_mem(more_abstract_memo, key, [&]() {
+			return MinerUtils::is_blk_more_abstract(l_blk, r_blk, var); });
+}
+
+bool Surprisingness::is_strictly_more_abstract_mem(const HandleSeq& l_blk,
+                                                   const HandleSeq& r_blk,
+                                                   const Handle& var)
+{
+	AbstractionMemKey key{MinerUtils::mk_body(l_blk),
+	                      MinerUtils::mk_body(r_blk), var};
+	return abstraction_mem(strictly_more_abstract_memo, key, [&]() {
+			return not is_equivalent(l_blk, r_blk, var)
+				and is_blk_more_abstract_mem(l_blk, r_blk, var); });
+}
+
+void Surprisingness::clear_abstraction_mem()
+{
+	std::lock_guard<std::mutex> lock(abstraction_memo_mtx);
+	more_abstract_memo.clear();
+	strictly_more_abstract_memo.clear();
+}
+
 void Surprisingness::rank_by_abstraction(HandleSeqSeq& partition, const Handle& var)
 {
-	boost::sort(partition,
-	            [&](const HandleSeq& l_blk, const HandleSeq& r_blk) {
-		            // sort operates on strict weak order so is
-		            // compatible with is_strictly_more_abstract
-		            return is_strictly_more_abstract(l_blk, r_blk, var);
-	            });
+	// Calculate the strict abstraction relationship between all
+	// pairs of blocks once
+	const size_t n = partition.size();
+	std::vector<char> more(n * n, false);
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++)
+			if (i != j)
+				more[i * n + j] =
+					is_strictly_more_abstract_mem(partition[i], partition[j], var);
+
+	// sort operates on strict weak order so is compatible with
+	// is_strictly_more_abstract. The block indices are sorted
+	// instead of the blocks so that the comparator is a mere lookup.
+	std::vector<size_t> indices(n);
+	for (size_t i = 0; i < n; i++)
+		indices[i] = i;
+	boost::sort(indices, [&](size_t l, size_t r) { return more[l * n + r]; });
+
+	HandleSeqSeq ranked;
+	ranked.reserve(n);
+	for (size_t i : indices)
+		ranked.push_back(std::move(partition[i]));
+	partition = std::move(ranked);
 }
 
 double Surprisingness::eq_prob(const HandleSeqSeq& partition,
                                const Handle& pattern,
-                               const HandleSeq& db)
+                               const HandleSeq& db,
+                               size_t db_fp)
 {
+	if (db_fp == 0)
+		db_fp = db_fingerprint(db);
 	double p = 1.0;
 	// Calculate the probability of a variable taking the same value
 	// across all blocks/subpatterns where that variable appears.
@@ -635,15 +963,15 @@ double Surprisingness::eq_prob(const HandleSeqSeq& partition,
 			// specialized abstraction.
 			int i = j-1;
 			while (0 <= i)
-				if (MinerUtils::is_blk_more_abstract(var_partition[i],
-				                                     var_partition[j],
-				                                     var))
+				if (is_blk_more_abstract_mem(var_partition[i],
+				                             var_partition[j],
+				                             var))
 					break;
 				else i--;
 
 			double c = db.size();
 			if (0 <= i)
-				c = value_count(var_partition[i], var, db);
+				c = value_count_mem(var_partition[i], var, db, db_fp);
 			p /= c;
 		}
 	}
@@ -694,6 +1022,25 @@ void Surprisingness::set_ji_tv_est(const Handle& pattern, TruthValuePtr jte)
 	pattern->setValue(ji_tv_est_key(), ValueCast(jte));
 }
 
+const Handle& Surprisingness::surp_key()
+{
+	static Handle sk(createNode(NODE, "*-SurprisingnessValueKey-*"));
+	return sk;
+}
+
+double Surprisingness::get_surp(const Handle& pattern)
+{
+	FloatValuePtr surp_fv = FloatValueCast(pattern->getValue(surp_key()));
+	if (surp_fv)
+		return surp_fv->value().front();
+	return std::numeric_limits<double>::quiet_NaN();
+}
+
+void Surprisingness::set_surp(const Handle& pattern, double surp)
+{
+	pattern->setValue(surp_key(), ValueCast(createFloatValue(surp)));
+}
+
 double Surprisingness::jsd(TruthValuePtr l_tv, TruthValuePtr r_tv)
 {
 	static int bins = 100;
@@ -715,6 +1062,107 @@ double Surprisingness::jsd(TruthValuePtr l_tv, TruthValuePtr r_tv)
 	return sqrt(avrg(ld, rd));
 }
 
+void Surprisingness::jsd(const TruthValueSeq& l_tvs,
+                         const TruthValueSeq& r_tvs,
+                         std::vector<double>& results,
+                         int bins)
+{
+	OC_ASSERT(l_tvs.size() == r_tvs.size());
+	OC_ASSERT(0 < bins);
+
+	// Allocate once for the whole batch, the left and right cdfs of
+	// a chunk of pairs laid out contiguously, followed by the pmf
+	// scratch buffer shared by all pairs. Pairs are processed by
+	// chunks so that the buffer does not grow with the batch.
+	static const size_t chunk_size = 256;
+	const size_t n = l_tvs.size();
+	const size_t m = std::min(n, chunk_size);
+	const size_t bsz = bins;
+	std::vector<double> buf(2 * m * bsz + 3 * bsz);
+	double* l_cdfs = buf.data();
+	double* r_cdfs = l_cdfs + m * bsz;
+	double* pmf = r_cdfs + m * bsz;
+
+	results.resize(n);
+	for (size_t begin = 0; begin < n; begin += m) {
+		size_t end = std::min(n, begin + m);
+		for (size_t i = begin; i < end; i++) {
+			size_t j = i - begin;
+			beta_cdf(BetaDistribution(l_tvs[i]), bins, l_cdfs + j * bsz);
+			beta_cdf(BetaDistribution(r_tvs[i]), bins, r_cdfs + j * bsz);
+		}
+		for (size_t i = begin; i < end; i++) {
+			size_t j = i - begin;
+			results[i] = jsd_kernel(l_cdfs + j * bsz, r_cdfs + j * bsz,
+			                        bins, pmf);
+		}
+	}
+}
+
+void Surprisingness::beta_cdf(const BetaDistribution& bd, int bins, double* cdf)
+{
+	// Recover the shape parameters from the moments, see
+	// https://en.wikipedia.org/wiki/Beta_distribution#Mean_and_variance
+	double mean = bd.mean();
+	double variance = bd.variance();
+	double common = 0 < variance ? mean * (1.0 - mean) / variance - 1.0 : 0.0;
+	double alpha = mean * common;
+	double beta = (1.0 - mean) * common;
+
+	// If the distribution is degenerate, that is has no variance, or
+	// moments no beta distribution can have, then treat it as a
+	// point mass at its mean.
+	if (not (0 < alpha and 0 < beta and std::isfinite(common))) {
+		for (int i = 0; i < bins; i++)
+			cdf[i] = mean <= (i + 1.0) / bins ? 1.0 : 0.0;
+		return;
+	}
+	for (int i = 0; i < bins; i++)
+		cdf[i] = boost::math::ibeta(alpha, beta, (i + 1.0) / bins);
+}
+
+double Surprisingness::jsd_kernel(const double* l_cdf, const double* r_cdf,
+                                  int bins, double* pmf)
+{
+	double* l_pmf = pmf;
+	double* r_pmf = pmf + bins;
+	double* m_pmf = pmf + 2 * bins;
+
+	// Turn the cdfs into pmfs, and average them. Note that the pmf of
+	// the average of 2 cdfs is the average of their pmfs.
+	l_pmf[0] = l_cdf[0];
+	r_pmf[0] = r_cdf[0];
+	for (int i = 1; i < bins; i++) {
+		l_pmf[i] = l_cdf[i] - l_cdf[i - 1];
+		r_pmf[i] = r_cdf[i] - r_cdf[i - 1];
+	}
+	for (int i = 0; i < bins; i++)
+		m_pmf[i] = avrg(l_pmf[i], r_pmf[i]);
+
+	double
+		ld = kld_kernel(l_pmf, m_pmf, bins),
+		rd = kld_kernel(r_pmf, m_pmf, bins);
+	return sqrt(avrg(ld, rd));
+}
+
+double Surprisingness::kld_kernel(const double* l_pmf, const double* r_pmf,
+                                  int bins)
+{
+	static const double epsilon = 1e-32;
+
+	// Like kld, but the test discarding null probabilities is turned
+	// into a mask so that the loop has no branch.
+	double kldi = 0.0;
+	for (int i = 0; i < bins; i++) {
+		double lp = l_pmf[i];
+		double rp = r_pmf[i];
+		double mask = (epsilon < lp and epsilon < rp) ? 1.0 : 0.0;
+		double ratio = std::max(lp, epsilon) / std::max(rp, epsilon);
+		kldi += mask * lp * std::log2(ratio);
+	}
+	return kldi;
+}
+
 double Surprisingness::kld(const std::vector<double>& l_cdf,
                            const std::vector<double>& r_cdf)
 {
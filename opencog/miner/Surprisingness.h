@@ -23,6 +23,8 @@
 #ifndef OPENCOG_SURPRISINGNESS_H_
 #define OPENCOG_SURPRISINGNESS_H_
 
+#include <random>
+
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/atoms/core/LambdaLink.h>
 #include <opencog/atomspace/AtomSpace.h>
@@ -331,11 +333,34 @@ public:
 	 *
 	 * As of today the code calculates the exact count (thus is rather
 	 * slow). We have not experimented with approximated counts yet.
+	 *
+	 * db_fp is the fingerprint of db (see db_fingerprint), calculated
+	 * here if 0, so that a batch only calculates it once.
 	 */
 	static double isurp(const Handle& pattern,
 	                    const HandleSeq& db,
 	                    bool normalize=true,
-	                    double db_ratio=1.0);
+	                    double db_ratio=1.0,
+	                    size_t db_fp=0);
+
+	/**
+	 * Batch version of isurp. Return the (normalized if requested)
+	 * I-Surprisingness of each pattern of patterns, in the same order.
+	 *
+	 * The patterns are processed by jobs threads, by increasing number
+	 * of conjuncts so that the probabilities of smaller patterns,
+	 * memoized in the atomspace, as well as the values and
+	 * abstraction memos (see values_mem and is_blk_more_abstract_mem),
+	 * are shared by all patterns of the batch. The copy of db used by
+	 * the pattern matcher is also reused across the batch by each
+	 * thread (see MinerUtils::restricted_satisfying_set). The values
+	 * and abstraction memos are cleared at the end of the batch.
+	 */
+	static std::vector<double> isurp_batch(const HandleSeq& patterns,
+	                                       const HandleSeq& db,
+	                                       bool normalize=true,
+	                                       double db_ratio=1.0,
+	                                       unsigned jobs=1);
 
 	/**
 	 * Return the distance between a value and an interval
@@ -409,6 +434,52 @@ public:
 	                                        const Handle& var,
 	                                        const HandleSeq& db);
 
+	/**
+	 * Like value_count and value_distribution but memoized.
+	 *
+	 * The memo is shared by all calls (thus across partitions and
+	 * patterns of a whole surprisingness run) and is keyed by the body
+	 * of the block, so that the same block/variable pair occuring in
+	 * different partitions, possibly with clauses in a different order,
+	 * is only matched once, and by a fingerprint of db, so that
+	 * different dbs (subsamples included) do not collide. That
+	 * fingerprint, db_fp, is calculated if 0.
+	 */
+	static unsigned value_count_mem(const HandleSeq& block,
+	                                const Handle& var,
+	                                const HandleSeq& db,
+	                                size_t db_fp=0);
+	static HandleCounter value_distribution_mem(const HandleSeq& block,
+	                                            const Handle& var,
+	                                            const HandleSeq& db,
+	                                            size_t db_fp=0);
+
+	/**
+	 * Return the values (groundings), and their counts, of var in the
+	 * given block against db, memoized, see value_count_mem.
+	 */
+	static HandleUCounter values_mem(const HandleSeq& block,
+	                                 const Handle& var,
+	                                 const HandleSeq& db,
+	                                 size_t db_fp=0);
+
+	/**
+	 * Empty the memo of values_mem, to free memory once a
+	 * surprisingness run is over.
+	 */
+	static void clear_values_mem();
+
+	/**
+	 * Return a hash of db based on the content of its data trees,
+	 * never 0 (see MinerUtils::db_fingerprint).
+	 */
+	static size_t db_fingerprint(const HandleSeq& db);
+
+	/**
+	 * Turn value counts into a probability distribution.
+	 */
+	static HandleCounter to_distribution(const HandleUCounter& values);
+
 	/**
 	 * Perform the inner product of a collection of distributions.
 	 *
@@ -461,11 +532,19 @@ public:
 	static double emp_prob_subsmp(const Handle& pattern,
 	                              const HandleSeq& db,
 	                              unsigned subsize=UINT_MAX);
+	static double emp_prob_subsmp(const Handle& pattern,
+	                              const HandleSeq& db,
+	                              unsigned subsize,
+	                              std::mt19937& rng);
 
 	/**
 	 * Like emp_prob but uses bootstrapping for more
 	 * efficiency. n_resample is the number of subsamplings taking
 	 * place, and subsize is the size of each subsample.
+	 *
+	 * The subsamples are drawn from a generator seeded by the pattern
+	 * (see subsmp_rng), so that the result is reproducible and this
+	 * can be called concurrently.
 	 */
 	static double emp_prob_bs(const Handle& pattern,
 	                          const HandleSeq& db,
@@ -487,7 +566,8 @@ public:
 	 */
 	static double emp_prob_pbs(const Handle& pattern,
 	                           const HandleSeq& db,
-	                           double db_ratio);
+	                           double db_ratio,
+	                           size_t db_fp=0);
 	static double emp_prob_pbs(const Handle& pattern,
 	                           const HandleSeq& db,
 	                           double prob_estimate,
@@ -498,7 +578,8 @@ public:
 	 */
 	static double emp_prob_pbs_mem(const Handle& pattern,
 	                               const HandleSeq& db,
-	                               double db_ratio);
+	                               double db_ratio,
+	                               size_t db_fp=0);
 	static double emp_prob_pbs_mem(const Handle& pattern,
 	                               const HandleSeq& db,
 	                               double prob_estimate,
@@ -523,11 +604,16 @@ public:
 	static TruthValuePtr emp_tv_subsmp(const Handle& pattern,
 	                                   const HandleSeq& db,
 	                                   unsigned subsize=UINT_MAX);
+	static TruthValuePtr emp_tv_subsmp(const Handle& pattern,
+	                                   const HandleSeq& db,
+	                                   unsigned subsize,
+	                                   std::mt19937& rng);
 
 	/**
 	 * Like emp_tv but uses bootstrapping for more
 	 * efficiency. n_resample is the number of subsamplings taking
-	 * place, and subsize is the size of each subsample.
+	 * place, and subsize is the size of each subsample. Like
+	 * emp_prob_bs the subsamples are seeded by the pattern.
 	 */
 	static TruthValuePtr emp_tv_bs(const Handle& pattern,
 	                               const HandleSeq& db,
@@ -558,9 +644,18 @@ public:
 
 	/**
 	 * Randomly subsample db so that the resulting db has size
-	 * subsize.
+	 * subsize. The first one draws from the global random generator,
+	 * thus is not thread safe, the second one from rng.
 	 */
 	static HandleSeq subsmp(const HandleSeq& db, unsigned subsize);
+	static HandleSeq subsmp(const HandleSeq& db, unsigned subsize,
+	                        std::mt19937& rng);
+
+	/**
+	 * Return a random generator seeded by the content of pattern, to
+	 * subsample the db when bootstrapping its empirical probability.
+	 */
+	static std::mt19937 subsmp_rng(const Handle& pattern);
 
 	/**
 	 * Determine the number of samples and the subsample size given a
@@ -604,11 +699,15 @@ public:
 
 	/**
 	 * Calculate min and max probability estimates of a pattern by
-	 * applying ji_prob_est over all its possible partitions.
+	 * applying ji_prob_est over all its possible partitions. db_fp
+	 * is the fingerprint of db, calculated if 0. If n_partitions is
+	 * provided, then the number of partitions is stored in it.
 	 */
 	static std::pair<double, double> ji_prob_est_interval(const Handle& pattern,
 	                                                      const HandleSeq& db,
-	                                                      double db_ratio);
+	                                                      double db_ratio,
+	                                                      size_t db_fp=0,
+	                                                      size_t* n_partitions=nullptr);
 
 	/**
 	 * Calculate probability estimate of a pattern given a partition,
@@ -619,7 +718,8 @@ public:
 	static double ji_prob_est(const HandleSeqSeq& partition,
 	                          const Handle& pattern,
 	                          const HandleSeq& db,
-	                          double db_ratio);
+	                          double db_ratio,
+	                          size_t db_fp=0);
 
 	/**
 	 * Calculate truth value estimate of a pattern given a partition,
@@ -686,9 +786,34 @@ public:
 	                                      const HandleSeq& r_blk,
 	                                      const Handle& var);
 
+	/**
+	 * Like MinerUtils::is_blk_more_abstract and
+	 * is_strictly_more_abstract but memoized.
+	 *
+	 * Since these relationships are purely syntactic, the memo is
+	 * shared by all calls and keyed by the bodies of both blocks and
+	 * var, regardless of the db.
+	 */
+	static bool is_blk_more_abstract_mem(const HandleSeq& l_blk,
+	                                     const HandleSeq& r_blk,
+	                                     const Handle& var);
+	static bool is_strictly_more_abstract_mem(const HandleSeq& l_blk,
+	                                          const HandleSeq& r_blk,
+	                                          const Handle& var);
+
+	/**
+	 * Empty the memos of is_blk_more_abstract_mem and
+	 * is_strictly_more_abstract_mem.
+	 */
+	static void clear_abstraction_mem();
+
 	/**
 	 * Sort the partition such that if block A is strictly more
 	 * abstract than block B relative var, then A occurs before B.
+	 *
+	 * The abstraction relationship between all pairs of blocks is
+	 * calculated once (and memoized) before sorting, so that the sort
+	 * itself only looks up a matrix.
 	 */
 	static void rank_by_abstraction(HandleSeqSeq& partition, const Handle& var);
 
@@ -702,7 +827,8 @@ public:
 	 */
 	static double eq_prob(const HandleSeqSeq& partition,
 	                      const Handle& pattern,
-	                      const HandleSeq& db);
+	                      const HandleSeq& db,
+	                      size_t db_fp=0);
 
 	/**
 	 * Key of the empirical truth value
@@ -728,6 +854,19 @@ public:
 	static TruthValuePtr get_ji_tv_est(const Handle& pattern);
 	static void set_ji_tv_est(const Handle& pattern, TruthValuePtr etv);
 
+	/**
+	 * Key of the surprisingness
+	 */
+	static const Handle& surp_key();
+
+	/**
+	 * Get/set the surprisingness of the given pattern, as calculated
+	 * by any of the measures above. Get returns NaN if none has been
+	 * set.
+	 */
+	static double get_surp(const Handle& pattern);
+	static void set_surp(const Handle& pattern, double surp);
+
 	/**
 	 * Given 2 TVs, typically representing the empirical probability
 	 * and the probability estimate of a pattern, calculate the
@@ -735,6 +874,48 @@ public:
 	 */
 	static double jsd(TruthValuePtr l_tv, TruthValuePtr r_tv);
 
+	/**
+	 * Batch version of jsd. Given 2 sequences of TVs of the same size,
+	 * fill results so that results[i] is the Jensen-Shannon distance
+	 * between l_tvs[i] and r_tvs[i], discretized over the given number
+	 * of bins.
+	 *
+	 * The cdfs of a batch are evaluated, by chunks of a few hundred
+	 * pairs, in a single preallocated contiguous buffer, thus of
+	 * bounded size, and the mixture and kld are computed by the
+	 * branch-free kernels below, which compilers can auto-vectorize,
+	 * instead of allocating fresh vectors for every pair.
+	 */
+	static void jsd(const TruthValueSeq& l_tvs,
+	                const TruthValueSeq& r_tvs,
+	                std::vector<double>& results,
+	                int bins=100);
+
+	/**
+	 * Write in cdf (of size bins) the cdf of the given beta
+	 * distribution at regularly spaced right-end points, like
+	 * BetaDistribution::cdf(bins) but without allocation. A degenerate
+	 * distribution, without variance, is treated as a point mass at
+	 * its mean.
+	 */
+	static void beta_cdf(const BetaDistribution& bd, int bins, double* cdf);
+
+	/**
+	 * Jensen-Shannon distance between 2 cdfs of size bins, described
+	 * like in kld. pmf is a scratch buffer of size 3*bins used to hold
+	 * the left, right and mixture probability mass functions.
+	 */
+	static double jsd_kernel(const double* l_cdf, const double* r_cdf,
+	                         int bins, double* pmf);
+
+	/**
+	 * Given 2 probability mass functions of size bins, return their
+	 * Kullback-Leibler divergence. Like kld but over pmfs laid out in
+	 * contiguous buffers.
+	 */
+	static double kld_kernel(const double* l_pmf, const double* r_pmf,
+	                         int bins);
+
 	/**
 	 * Given 2 cdfs (cummulative distribution functions) return their
 	 * Kullback-Leibler divergence.
@@ -0,0 +1,219 @@
+/*
+ * SyntheticKB.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SyntheticKB.h"
+#include "HandleTree.h"
+#include "MinerUtils.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencog/util/oc_assert.h>
+#include <opencog/atoms/atom_types/NameServer.h>
+#include <opencog/atoms/base/Node.h>
+
+namespace opencog
+{
+
+SyntheticKBParameters::SyntheticKBParameters(size_t dts, size_t n, double z,
+                                             unsigned d, unsigned p,
+                                             unsigned s)
+	: data_trees(dts), node_types({CONCEPT_NODE}), nodes(n),
+	  link_types({{INHERITANCE_LINK, 2}}), zipf(z), depth(d), branching(4),
+	  planted(p), conjuncts(2), support(0.01), seed(s) {}
+
+/**
+ * Return the name prefix of the nodes of a given type, its name
+ * without the Node suffix.
+ */
+static std::string type_prefix(Type type)
+{
+	std::string name = nameserver().getTypeName(type);
+	const std::string suffix = "Node";
+	if (suffix.size() < name.size() and
+	    name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+		name.resize(name.size() - suffix.size());
+	return name;
+}
+
+SyntheticKB::SyntheticKB(const SyntheticKBParameters& prm)
+	: param(prm) {}
+
+HandleSeq SyntheticKB::operator()(AtomSpace& as)
+{
+	OC_ASSERT(not param.node_types.empty() and not param.link_types.empty()
+	          and 0 < param.nodes and 0 < param.branching,
+	          "SyntheticKB requires node types, link types, nodes "
+	          "and a positive branching factor");
+
+	_rng.seed(param.seed);
+	_planted.clear();
+
+	// Cumulative distribution of the Zipfian distribution of ranks
+	_zipf_cdf.resize(param.nodes);
+	double total = 0.0;
+	for (size_t r = 0; r < param.nodes; r++) {
+		total += 1.0 / std::pow(r + 1, param.zipf);
+		_zipf_cdf[r] = total;
+	}
+	for (double& p : _zipf_cdf)
+		p /= total;
+
+	HandleSeq trees;
+	add_background(as, trees);
+	add_ontology(as, trees);
+	for (unsigned i = 0; i < param.planted; i++)
+		add_planted(as, trees, i);
+	_seen.clear();
+	return trees;
+}
+
+const HandleSeq& SyntheticKB::planted() const
+{
+	return _planted;
+}
+
+double SyntheticKB::recall(const HandleSeq& planted, const HandleSeq& patterns)
+{
+	if (planted.empty())
+		return 1.0;
+
+	ContentHandleSet index;
+	for (const Handle& pattern : patterns)
+		index.insert(pattern);
+	size_t found = 0;
+	for (const Handle& pattern : planted)
+		if (index.contains(pattern))
+			found++;
+	return (double)found / planted.size();
+}
+
+size_t SyntheticKB::zipf_rank()
+{
+	double u = std::uniform_real_distribution<double>(0.0, 1.0)(_rng);
+	auto it = std::lower_bound(_zipf_cdf.begin(), _zipf_cdf.end(), u);
+	return std::min((size_t)std::distance(_zipf_cdf.begin(), it),
+	                param.nodes - 1);
+}
+
+Handle SyntheticKB::node(AtomSpace& as, Type type, size_t rank) const
+{
+	return as.add_node(type, type_prefix(type) + "-" + std::to_string(rank));
+}
+
+bool SyntheticKB::add_tree(HandleSeq& trees, const Handle& tree)
+{
+	if (not _seen.insert(tree).second)
+		return false;
+	trees.push_back(tree);
+	return true;
+}
+
+void SyntheticKB::add_background(AtomSpace& as, HandleSeq& trees)
+{
+	std::uniform_int_distribution<size_t>
+		link_dist(0, param.link_types.size() - 1),
+		node_dist(0, param.node_types.size() - 1);
+
+	// Give up regenerating duplicates after enough attempts, in case
+	// the vocabulary is too small to have data_trees distinct trees.
+	size_t attempts = 10 * param.data_trees;
+	for (size_t n = 0; n < param.data_trees and 0 < attempts; attempts--) {
+		const auto& lt = param.link_types[link_dist(_rng)];
+		HandleSeq outgoing;
+		for (Arity i = 0; i < lt.second; i++)
+			outgoing.push_back(node(as, param.node_types[node_dist(_rng)],
+			                        zipf_rank()));
+		if (add_tree(trees, as.add_link(lt.first, std::move(outgoing))))
+			n++;
+	}
+}
+
+void SyntheticKB::add_ontology(AtomSpace& as, HandleSeq& trees)
+{
+	if (param.depth == 0)
+		return;
+
+	// Number of categories at each depth, capped to the number of
+	// nodes.
+	std::vector<size_t> n_categories(param.depth + 1, 1);
+	for (unsigned d = 1; d <= param.depth; d++)
+		n_categories[d] = std::min(n_categories[d - 1] * param.branching,
+		                           param.nodes);
+
+	for (Type type : param.node_types) {
+		std::string prefix = type_prefix(type) + "-category-";
+		auto category = [&](unsigned d, size_t i) {
+			return as.add_node(type, prefix + std::to_string(d)
+			                   + "-" + std::to_string(i));
+		};
+
+		for (size_t r = 0; r < param.nodes; r++)
+			add_tree(trees, as.add_link(INHERITANCE_LINK, node(as, type, r),
+			                            category(param.depth,
+			                                     r % n_categories[param.depth])));
+		for (unsigned d = param.depth; 1 < d; d--)
+			for (size_t i = 0; i < n_categories[d]; i++)
+				add_tree(trees, as.add_link(INHERITANCE_LINK, category(d, i),
+				                            category(d - 1, i / param.branching)));
+	}
+}
+
+void SyntheticKB::add_planted(AtomSpace& as, HandleSeq& trees, unsigned i)
+{
+	Type type = param.node_types.front();
+	Handle X = createNode(VARIABLE_NODE, "$X");
+
+	// Build the clauses, X followed by rare constants, taken from the
+	// tail of the distribution so that they are distinct across
+	// planted patterns.
+	Arity max_arity = 1;
+	for (const auto& lt : param.link_types)
+		max_arity = std::max(max_arity, lt.second);
+	HandleSeq clauses;
+	size_t constant = i * param.conjuncts * max_arity;
+	for (unsigned j = 0; j < param.conjuncts; j++) {
+		const auto& lt = param.link_types[(i + j) % param.link_types.size()];
+		HandleSeq outgoing{X};
+		for (Arity k = 1; k < lt.second; k++, constant++) {
+			size_t c = constant % param.nodes;
+			outgoing.push_back(node(as, type, param.nodes - 1 - c));
+		}
+		clauses.push_back(createLink(std::move(outgoing), lt.first));
+	}
+	_planted.push_back(MinerUtils::mk_pattern(X, clauses));
+
+	// Ground them with fresh nodes
+	size_t support = std::max(1.0, std::round(param.support
+	                                          * param.data_trees));
+	std::string prefix = type_prefix(type) + "-planted-"
+		+ std::to_string(i) + "-";
+	for (size_t g = 0; g < support; g++) {
+		Handle value = as.add_node(type, prefix + std::to_string(g));
+		for (const Handle& clause : clauses) {
+			HandleSeq outgoing(clause->getOutgoingSet());
+			outgoing[0] = value;
+			add_tree(trees, as.add_link(clause->get_type(), std::move(outgoing)));
+		}
+	}
+}
+
+} // ~namespace opencog
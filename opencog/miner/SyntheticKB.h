@@ -0,0 +1,177 @@
+/*
+ * SyntheticKB.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_SYNTHETICKB_H_
+#define OPENCOG_SYNTHETICKB_H_
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atomspace/AtomSpace.h>
+
+namespace opencog
+{
+
+/**
+ * Parameters of SyntheticKB.
+ */
+struct SyntheticKBParameters {
+	SyntheticKBParameters(size_t data_trees=10000,
+	                      size_t nodes=1000,
+	                      double zipf=1.0,
+	                      unsigned depth=0,
+	                      unsigned planted=0,
+	                      unsigned seed=0);
+
+	// Number of background data trees. Duplicates are regenerated, as
+	// long as the vocabulary allows it.
+	size_t data_trees;
+
+	// Node types of the vocabulary, and number of nodes per type.
+	std::vector<Type> node_types;
+	size_t nodes;
+
+	// Link types of the background data trees, with their arities.
+	std::vector<std::pair<Type, Arity>> link_types;
+
+	// Exponent of the Zipfian distribution of the nodes in the
+	// outgoing sets of the background data trees, 0 for uniform.
+	double zipf;
+
+	// Depth and branching factor of the ontology of each node type.
+	// If depth is positive, each node inherits from a category of
+	// depth, each category of depth d inheriting from a category of
+	// depth d-1. Each InheritanceLink is a data tree.
+	unsigned depth;
+	unsigned branching;
+
+	// Number of planted conjunctive patterns, their number of
+	// conjuncts, and their support as a ratio of data_trees.
+	unsigned planted;
+	unsigned conjuncts;
+	double support;
+
+	// Seed of the random generator, so that the same parameters always
+	// generate the same knowledge base.
+	unsigned seed;
+};
+
+/**
+ * Generator of synthetic knowledge bases, to test the scalability of
+ * the miner without relying on real datasets.
+ *
+ * The knowledge base is made of
+ *
+ * 1. background data trees, links of the given types and arities
+ *    over nodes drawn according to a Zipfian distribution,
+ *
+ * 2. an ontology, if depth is positive (see SyntheticKBParameters),
+ *
+ * 3. the groundings of planted patterns, conjunctions of clauses
+ *    sharing a variable, such as
+ *
+ *    (Lambda
+ *      (Variable "$X")
+ *      (Present
+ *        (Inheritance (Variable "$X") (Concept "Concept-907"))
+ *        (Inheritance (Variable "$X") (Concept "Concept-512"))))
+ *
+ *    where the constants are rare nodes, so that each planted pattern
+ *    is both frequent, with a support of at least support * data_trees,
+ *    and surprising, as its clauses hardly co-occur by chance. Each
+ *    grounding introduces a fresh node for the variable.
+ *
+ * The planted patterns can then be compared to the mined ones (see
+ * recall) to check that the miner finds them.
+ */
+class SyntheticKB
+{
+public:
+	SyntheticKB(const SyntheticKBParameters& param=SyntheticKBParameters());
+
+	/**
+	 * Generate the knowledge base in as, and return its data trees.
+	 */
+	HandleSeq operator()(AtomSpace& as);
+
+	/**
+	 * Return the planted patterns of the last generated knowledge
+	 * base.
+	 */
+	const HandleSeq& planted() const;
+
+	/**
+	 * Return the ratio of planted patterns found amongst patterns,
+	 * comparing patterns by content. Return 1 if there are no planted
+	 * patterns.
+	 */
+	static double recall(const HandleSeq& planted, const HandleSeq& patterns);
+
+	SyntheticKBParameters param;
+
+private:
+	/**
+	 * Return the rank of a node drawn according to the Zipfian
+	 * distribution.
+	 */
+	size_t zipf_rank();
+
+	/**
+	 * Return the node of the given type and rank.
+	 */
+	Handle node(AtomSpace& as, Type type, size_t rank) const;
+
+	/**
+	 * Append tree to trees, unless already there. Return true iff it
+	 * has been appended.
+	 */
+	bool add_tree(HandleSeq& trees, const Handle& tree);
+
+	/**
+	 * Add the background data trees to as and trees.
+	 */
+	void add_background(AtomSpace& as, HandleSeq& trees);
+
+	/**
+	 * Add the ontology to as and trees.
+	 */
+	void add_ontology(AtomSpace& as, HandleSeq& trees);
+
+	/**
+	 * Add a planted pattern, and its groundings to as and trees.
+	 */
+	void add_planted(AtomSpace& as, HandleSeq& trees, unsigned i);
+
+	std::mt19937 _rng;
+
+	// Cumulative distribution of node ranks
+	std::vector<double> _zipf_cdf;
+
+	// Data trees generated so far
+	HandleSet _seen;
+
+	HandleSeq _planted;
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_SYNTHETICKB_H_ */
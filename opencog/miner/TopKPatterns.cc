@@ -0,0 +1,114 @@
+/*
+ * TopKPatterns.cc
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TopKPatterns.h"
+
+#include <algorithm>
+
+#include <opencog/atoms/base/Atom.h>
+
+namespace opencog
+{
+
+TopKPatterns::TopKPatterns(unsigned k)
+	: _k(k), _n_arrivals(0) {}
+
+TopKPatterns::TopKPatterns(const TopKPatterns& other)
+	: _k(other._k), _heap(other._heap), _n_arrivals(other._n_arrivals),
+	  _index(other._index) {}
+
+TopKPatterns& TopKPatterns::operator=(const TopKPatterns& other)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_k = other._k;
+	_heap = other._heap;
+	_n_arrivals = other._n_arrivals;
+	_index = other._index;
+	return *this;
+}
+
+bool TopKPatterns::insert(const Handle& pattern, unsigned support)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_k == 0 or _index.contains(pattern))
+		return false;
+
+	Entry entry{support, _n_arrivals++, pattern};
+	if (_heap.size() == _k) {
+		// Not better than the worst, leave it out
+		if (not is_better(entry, _heap.front()))
+			return false;
+
+		// Otherwise remove the worst
+		std::pop_heap(_heap.begin(), _heap.end(), is_better);
+		_index.erase(_heap.back().pattern);
+		_heap.pop_back();
+	}
+
+	_heap.push_back(entry);
+	std::push_heap(_heap.begin(), _heap.end(), is_better);
+	_index.insert(pattern);
+	return true;
+}
+
+unsigned TopKPatterns::minsup(unsigned ms) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_k == 0 or _heap.size() < _k)
+		return ms;
+	return std::max(ms, _heap.front().support + 1);
+}
+
+HandleSeq TopKPatterns::patterns() const
+{
+	std::vector<Entry> entries;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		entries = _heap;
+	}
+	std::sort(entries.begin(), entries.end(), is_better);
+	HandleSeq pats;
+	for (const Entry& entry : entries)
+		pats.push_back(entry.pattern);
+	return pats;
+}
+
+size_t TopKPatterns::size() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _heap.size();
+}
+
+void TopKPatterns::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_heap.clear();
+	_index.clear();
+	_n_arrivals = 0;
+}
+
+bool TopKPatterns::is_better(const Entry& l, const Entry& r)
+{
+	return l.support > r.support
+		or (l.support == r.support and l.arrival < r.arrival);
+}
+
+} // ~namespace opencog
@@ -0,0 +1,120 @@
+/*
+ * TopKPatterns.h
+ *
+ * Copyright (C) 2019 SingularityNET Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef OPENCOG_TOPKPATTERNS_H_
+#define OPENCOG_TOPKPATTERNS_H_
+
+#include <mutex>
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+
+#include "HandleTree.h"
+
+namespace opencog
+{
+
+/**
+ * The k patterns of highest support found so far, kept in a min-heap
+ * so that the pattern of lowest support can be replaced in
+ * logarithmic time.
+ *
+ * Once k patterns are held, a new pattern must have a support
+ * strictly greater than the lowest one to get in, thus the minimum
+ * support used to prune the search can be raised to that lowest
+ * support plus one (see minsup). Patterns of equal support are
+ * favored in order of arrival.
+ *
+ * Patterns are compared by content, so that the same pattern is not
+ * held twice.
+ *
+ * All methods are thread safe.
+ */
+class TopKPatterns
+{
+public:
+	/**
+	 * CTor. k is the number of patterns to keep.
+	 */
+	TopKPatterns(unsigned k=0);
+	TopKPatterns(const TopKPatterns& other);
+	TopKPatterns& operator=(const TopKPatterns& other);
+
+	/**
+	 * Insert pattern with the given support, if it is not already
+	 * held and its support is high enough, possibly replacing the
+	 * pattern of lowest support. Return true iff pattern has been
+	 * inserted.
+	 */
+	bool insert(const Handle& pattern, unsigned support);
+
+	/**
+	 * Return the minimum support a pattern must have to get in, or
+	 * ms if greater.
+	 */
+	unsigned minsup(unsigned ms) const;
+
+	/**
+	 * Return the held patterns, by decreasing support.
+	 */
+	HandleSeq patterns() const;
+
+	/**
+	 * Return the number of held patterns.
+	 */
+	size_t size() const;
+
+	/**
+	 * Remove all held patterns.
+	 */
+	void clear();
+
+private:
+	struct Entry
+	{
+		unsigned support;
+		unsigned arrival;
+		Handle pattern;
+	};
+
+	/**
+	 * Return true iff l is better than r, that is it has a higher
+	 * support, or the same support but arrived earlier.
+	 */
+	static bool is_better(const Entry& l, const Entry& r);
+
+	unsigned _k;
+
+	// Heap of held patterns, the first one being the worst (see
+	// is_better).
+	std::vector<Entry> _heap;
+
+	// Number of patterns inserted so far, to break ties
+	unsigned _n_arrivals;
+
+	// Held patterns, indexed by content
+	ContentHandleSet _index;
+
+	mutable std::mutex _mutex;
+};
+
+} // ~namespace opencog
+
+#endif /* OPENCOG_TOPKPATTERNS_H_ */
@@ -32,6 +32,8 @@
 
 #include "MinerUtils.h"
 #include "Valuations.h"
+#include "MinerStats.h"
+#include "MinerTrace.h"
 
 namespace opencog
 {
@@ -168,6 +170,9 @@ std::string SCValuations::to_string(const std::string& indent) const
 Valuations::Valuations(const Handle& pattern, const HandleSeq& db)
 	: ValuationsBase(MinerUtils::get_variables(pattern))
 {
+	MinerStats::Timer timer(MinerStats::ValuationsConstruction);
+	MinerTrace::Scope trace("valuations", pattern, db.size());
+
 	// Useless clauses (like redundant, constants, and more) are
 	// removed in order to simplify subsequent processing, and avoid
 	// warnings from the pattern matcher
@@ -178,6 +183,8 @@ Valuations::Valuations(const Handle& pattern, const HandleSeq& db)
 		scvs.insert(SCValuations(MinerUtils::get_variables(cp), satset));
 	}
 	setup_size();
+	timer.rows(_size);
+	trace.rows(_size);
 }
 
 Valuations::Valuations(const Variables& vars, const SCValuationsSet& sc)
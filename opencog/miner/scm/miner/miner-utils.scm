@@ -50,6 +50,16 @@
 (define default-enable-type #f)
 (define default-enable-glob #f)
 (define default-ignore-variables '())
+(define default-maximum-time -1)
+(define default-maximum-memory -1)
+(define default-top-k -1)
+(define default-output-mode 'all)
+(define default-checkpoint #f)
+(define default-checkpoint-period 600)
+(define default-resume #f)
+(define default-stats #f)
+(define default-trace #f)
+(define default-progress-interval -1)
 
 ;; For some crazy reason I need to repaste absolutely-true here while
 ;; it is already defined in ure.
@@ -168,6 +178,39 @@
     (for-each mk-member db-lst))
   db-cpt)
 
+(define* (synthetic-kb db-cpt
+                       #:key
+                       (data-trees 10000)
+                       (nodes 1000)
+                       (zipf 1)
+                       (depth 0)
+                       (planted 0)
+                       (seed 0))
+"
+  Usage: (synthetic-kb db-cpt
+                       #:data-trees dt
+                       #:nodes n
+                       #:zipf z
+                       #:depth d
+                       #:planted p
+                       #:seed s)
+
+  Generate a synthetic knowledge base in the current atomspace, made
+  of dt inheritance links between n concepts drawn according to a
+  Zipfian distribution of exponent z, an ontology of depth d, and the
+  groundings of p planted conjunctive patterns. Its data trees are
+  associated to db-cpt, so that it can be passed to cog-mine.
+
+  Return the list of planted patterns, to check that they are mined.
+"
+  (cog-outgoing-set (cog-add-synthetic-kb db-cpt
+                                          (Number data-trees)
+                                          (Number nodes)
+                                          (Number zipf)
+                                          (Number depth)
+                                          (Number planted)
+                                          (Number seed))))
+
 (define (configure-mandatory-rules pm-rbs)
   ;; Maybe remove, nothing is mandatory anymore
   *unspecified*)
@@ -316,6 +359,48 @@
              (jsd-def (Define jsd-alias (gen-jsd-rule))))
         (ure-add-rules surp-rbs (list emp-alias est-alias jsd-alias)))))
 
+(define (batch-surprisingness? mode)
+"
+  Return #t iff the surprisingness measure mode can be calculated by
+  batch-surprisingness, rather than by the backward chainer.
+"
+  (or (eq? mode 'isurp) (eq? mode 'nisurp)))
+
+(define (pattern-conjuncts pattern)
+"
+  Return the number of conjuncts of pattern, assuming it has a
+  variable declaration, like the patterns produced by the miner.
+"
+  (let* ((body (cog-outgoing-atom pattern 1)))
+    (if (eq? (cog-type body) 'PresentLink)
+        (cog-arity body)
+        1)))
+
+(define (batch-surprisingness mode patterns db-cpt maximum-conjuncts db-ratio jobs)
+"
+  Calculate the surprisingness of all patterns with 2 to
+  maximum-conjuncts conjuncts (like the surprisingness rules do) in a
+  single batch, using jobs threads. Return the list of surprisingness
+  evaluations
+
+  Evaluation (stv <surprisingness> 1)
+    Predicate \"mode\"
+    List
+      <pattern>
+      db-cpt
+
+  where mode can be 'isurp or 'nisurp.
+"
+  (let* ((surp-op (if (eq? mode 'isurp) cog-isurp-batch cog-nisurp-batch))
+         (conjunctive? (lambda (pattern)
+                         (let* ((nc (pattern-conjuncts pattern)))
+                           (and (< 1 nc) (<= nc maximum-conjuncts)))))
+         (surp-patterns (filter conjunctive? patterns)))
+    (cog-outgoing-set (surp-op (List surp-patterns)
+                               db-cpt
+                               (Number db-ratio)
+                               (Number jobs)))))
+
 (define (pattern-var)
   (Variable "$pattern"))
 
@@ -476,12 +561,17 @@
 
 (define (get-members C)
 "
-  Given a concept node C, return all its members
+  Given a concept node C, return all its members, that is the data
+  trees loaded into it by cog-load-db, if any, or otherwise the atoms
+  linked to it by MemberLinks.
 "
-  (let* ((member-links (cog-filter 'MemberLink (cog-incoming-set C)))
-         (member-of-C (lambda (x) (equal? C (gdr x))))
-         (members (map gar (filter member-of-C member-links))))
-    members))
+  (let* ((db-lv (cog-value C (Node "*-DataTreesKey-*"))))
+    (if db-lv
+        (cog-value->list db-lv)
+        (let* ((member-links (cog-filter 'MemberLink (cog-incoming-set C)))
+               (member-of-C (lambda (x) (equal? C (gdr x))))
+               (members (map gar (filter member-of-C member-links))))
+          members))))
 
 (define (get-cardinality C)
 "
@@ -559,6 +649,40 @@
 (define* (cog-miner . args)
   (display ("The command you are looking for is cog-mine.")))
 
+(define (output-patterns om patterns-lst db)
+"
+  Given the output mode of cog-mine, om, either 'all, 'closed or
+  'maximal, a list of patterns mined over db, return the patterns to
+  output.
+"
+  (cond ((equal? om 'closed)
+         (cog-outgoing-set (cog-closed-patterns (List patterns-lst) db)))
+        ((equal? om 'maximal)
+         (cog-outgoing-set (cog-maximal-patterns (List patterns-lst) db)))
+        (else patterns-lst)))
+
+(define (stop-miner-instrumentation stats trace)
+"
+  If stats is true, stop recording the hot path statistics of the
+  miner and log them. If trace is a filename, stop tracing to it.
+"
+  (if stats
+      (begin (cog-stop-miner-stats)
+             (miner-logger-info "Miner statistics:\n~a" (cog-miner-stats))))
+  (if trace
+      (begin (cog-stop-miner-trace)
+             (miner-logger-info "Pattern evaluations traced to ~a" trace))))
+
+(define last-mine-truncated #f)
+
+(define (cog-mine-truncated?)
+"
+  Return #t iff the last call of cog-mine has been cut off by its time
+  or memory limit (see the #:maximum-time and #:maximum-memory options
+  of cog-mine), thus only returned the patterns found until then.
+"
+  last-mine-truncated)
+
 (define (to-number n)
 "
   Take a scheme number or a number node in argument
@@ -640,7 +764,39 @@
                    (enable-glob default-enable-glob)
 
                    ;; Variables to leave untouched
-                   (ignore-variables default-ignore-variables))
+                   (ignore-variables default-ignore-variables)
+
+                   ;; Maximum wall-clock time in seconds
+                   (maxtime default-maximum-time)
+                   (maximum-time default-maximum-time)
+
+                   ;; Maximum memory usage in megabytes
+                   (maxmem default-maximum-memory)
+                   (maximum-memory default-maximum-memory)
+
+                   ;; Number of patterns of highest support to return
+                   (topk default-top-k)
+                   (top-k default-top-k)
+
+                   ;; Whether to return all, closed or maximal patterns
+                   (output-mode default-output-mode)
+
+                   ;; Checkpoint file, and minimum number of seconds
+                   ;; between checkpoints
+                   (checkpoint default-checkpoint)
+                   (checkpoint-period default-checkpoint-period)
+
+                   ;; Whether to resume from the checkpoint file
+                   (resume default-resume)
+
+                   ;; Whether to record and log hot path statistics
+                   (stats default-stats)
+
+                   ;; File to trace the cost of each pattern evaluation to
+                   (trace default-trace)
+
+                   ;; Minimum number of seconds between progress reports
+                   (progress-interval default-progress-interval))
 "
   Mine patterns in db (data trees, a.k.a. grounded hypergraphs) with minimum
   support ms, optionally using mi iterations and starting from the initial
@@ -663,7 +819,17 @@
                    #:db-ratio dbr
                    #:enable-type et
                    #:enable-glob eg
-                   #:ignore-variables iv)
+                   #:ignore-variables iv
+                   #:maximum-time mt                (or #:maxtime mt)
+                   #:maximum-memory mm              (or #:maxmem mm)
+                   #:top-k tk                       (or #:topk tk)
+                   #:output-mode om
+                   #:checkpoint cf
+                   #:checkpoint-period cfp
+                   #:resume rs
+                   #:stats st
+                   #:trace tf
+                   #:progress-interval pi)
 
   db: Collection of data trees to mine. It can be given in 3 forms
 
@@ -764,6 +930,10 @@
       'nisurp:     New implementation of normalized I-Surprisingness
                    that takes linkage into account.
 
+                   'isurp and 'nisurp are calculated over all mined
+                   patterns in a single batch, using jb threads,
+                   instead of the backward chainer.
+
       'jsdsurp:    Jensen-Shannon Distance based surprisingness.
                    The type of surprisingness is determined by the way
                    the truth value estimate is calculated.
@@ -818,6 +988,76 @@
       instance in temporal mining, where the temporal variable must be left
       untouched.
 
+  mt: [optional, default=-1] Maximum wall-clock time in seconds allocated
+      to mining (surprisingness excluded). Once exceeded, no more pattern
+      is produced and the patterns found so far are returned. If negative
+      then no time limit. See cog-mine-truncated?.
+
+  mm: [optional, default=-1] Maximum memory usage of the process in
+      megabytes. Like mt, once exceeded, no more pattern is produced and
+      the patterns found so far are returned. If negative then no memory
+      limit. See cog-mine-truncated?.
+
+  tk: [optional, default=-1] If positive, only return the tk patterns of
+      highest support, by decreasing support (before surprisingness is
+      applied). Once tk patterns have been found, the minimum support is
+      raised to the support of the worst of them plus one, pruning the
+      search accordingly. It is thus possible to leave ms low and let
+      the miner find the right minimum support. If negative then all
+      patterns reaching ms are returned.
+
+  om: [optional, default='all] Which patterns to return. The supported
+      modes are:
+
+      'all:     All patterns reaching ms.
+
+      'closed:  Only closed patterns, that is patterns with no
+                specialization of equal support.
+
+      'maximal: Only maximal patterns, that is patterns with no
+                specialization reaching ms.
+
+      Specializations are the ones produced while mining, which are
+      recorded as they are produced. Thus patterns that have not been
+      specialized, for lack of iterations or otherwise, are considered
+      closed and maximal.
+
+  cf: [optional, default=#f] If a filename, the patterns found so far,
+      with their supports, are regularly written to that file, at most
+      every cfp seconds, as well as once mining is over, including when
+      cut off by mt or mm. If #f then no checkpoint is written.
+
+  cfp: [optional, default=600] Minimum number of seconds between 2
+       checkpoints.
+
+  rs: [optional, default=#f] Flag whether to resume from the checkpoint
+      file cf, if it exists. The patterns it contains, with enough
+      support, are used as sources along with the initial pattern, and
+      since their supports are restored, re-specializing them does not
+      require to match them against db again. Given enough iterations
+      (or mi negative), a resumed run finds the same patterns as an
+      uninterrupted one. mi is not decreased by the iterations of the
+      interrupted run.
+
+  st: [optional, default=#f] Flag whether to record the number of
+      calls, time, rows processed and cache hits and misses of the hot
+      paths of the miner (pattern matcher queries, valuations, shallow
+      abstractions, conjunction expansions, surprisingness partitions,
+      etc), and log them at the info level once mining is over. They
+      can also be retrieved afterwards with (cog-miner-stats).
+
+  tf: [optional, default=#f] If a filename, the cost of each pattern
+      evaluation (support, valuations, shallow specialization and
+      I-Surprisingness), its wall time, number of data trees matched
+      against, rows produced and memory growth, is written to that
+      CSV file, to find out which patterns are the most expensive.
+
+  pi: [optional, default=-1] If positive or null, the progress of
+      mining (patterns explored and accepted, conjuncts, throughput,
+      cache hit rate and memory usage) is logged at the info level at
+      most every pi seconds, and once more when mining is over. If
+      negative then no progress is reported.
+
   Under the hood it will create a rule base and a query for the rule
   engine, configure it according to the user's options and run it.
   Everything takes place in a child atomspace. After the job is done
@@ -834,7 +1074,8 @@
 
   2. If it takes too long to complete, it means the search tree is
      too large to explore entirely. Lower the number of iterations
-     of the rule engine, mi, to halt the exploration earlier.
+     of the rule engine, mi, to halt the exploration earlier, or set
+     a time or memory limit, mt or mm.
 
   3. If you have any idea of the kind of patterns you are looking
      for, you can provide an initial pattern, ip. All mined patterns
@@ -981,6 +1222,33 @@
           ((diff? maxcevar default-maximum-cnjexp-variables) maxcevar)
           (else default-maximum-cnjexp-variables)))
 
+  ;; Set maximum time
+  (define mt
+    (to-number
+     (cond ((num-diff? maximum-time default-maximum-time) maximum-time)
+           ((num-diff? maxtime default-maximum-time) maxtime)
+           (else default-maximum-time))))
+
+  ;; Set maximum memory
+  (define mm
+    (to-number
+     (cond ((num-diff? maximum-memory default-maximum-memory) maximum-memory)
+           ((num-diff? maxmem default-maximum-memory) maxmem)
+           (else default-maximum-memory))))
+
+  ;; Set top-k
+  (define tk
+    (to-number
+     (cond ((num-diff? top-k default-top-k) top-k)
+           ((num-diff? topk default-top-k) topk)
+           (else default-top-k))))
+
+  ;; Set checkpoint period
+  (define ckpp (to-number checkpoint-period))
+
+  ;; Set progress interval
+  (define pi (to-number progress-interval))
+
   ;; Set surprisingness
   (define su
     (cond ((diff? surprisingness default-surprisingness) surprisingness)
@@ -1007,6 +1275,7 @@
         ;; The initial pattern doesn't have enough support, thus the
         ;; solution set is empty.
         (begin (cog-set-atomspace! parent-as)
+               (set! last-mine-truncated #f)
                (miner-logger-debug "Initial pattern:\n~a" (get-initial-pattern))
                (miner-logger-debug "Does not have enough support (min support = ~a)" ms)
                (miner-logger-debug "Abort pattern mining")
@@ -1015,8 +1284,30 @@
 
         ;; The initial pattern has enough support, let's configure the
         ;; rule engine and run the pattern mining query
-        (let* (;; Configure pattern miner forward chainer
-               (source (minsup-eval-true (get-initial-pattern) db-cpt ms-n))
+        (let* (;; Record hot path statistics, if required
+               (dummy (if stats (cog-start-miner-stats)))
+               ;; Trace the cost of each pattern evaluation, if required
+               (dummy (if trace (cog-start-miner-trace trace)))
+               ;; Checkpoint the patterns found, if required, and
+               ;; resume from the last checkpoint, if any
+               (dummy (if checkpoint
+                          (cog-start-miner-checkpoint db-cpt checkpoint
+                                                      (Number ckpp))))
+               (resumed (if (and checkpoint resume (file-exists? checkpoint))
+                            (filter (lambda (p) (cog-enough-support? p db-cpt ms-n))
+                                    (cog-outgoing-set
+                                     (cog-resume-miner-checkpoint db-cpt)))
+                            '()))
+               (dummy (if (not (null? resumed))
+                          (miner-logger-info "Resume from ~a patterns" (length resumed))))
+               ;; Configure pattern miner forward chainer
+               (initial-source (minsup-eval-true (get-initial-pattern) db-cpt ms-n))
+               (source (if (null? resumed)
+                           initial-source
+                           (Set (delete-duplicates
+                                 (cons initial-source
+                                       (map (lambda (p) (minsup-eval-true p db-cpt ms-n))
+                                            resumed))))))
                (miner-rbs (random-miner-rbs-cpt))
                (cfg-m (configure-miner miner-rbs
                                        #:jobs jobs
@@ -1036,38 +1327,76 @@
                (dummy (miner-logger-debug "Has enough support (min support = ~a)" ms))
                (dummy (miner-logger-debug "Launch URE-based pattern mining"))
 
-               ;; Run pattern miner in a forward way
+               ;; Run pattern miner in a forward way, within the time
+               ;; and memory budget
+               (dummy (cog-start-miner-budget db-cpt (Number mt) (Number mm)))
+               ;; Report progress, if required
+               (dummy (if (<= 0 pi)
+                          (cog-start-miner-progress db-cpt (Number pi))))
+               ;; Keep track of the top-k patterns, if enabled
+               (dummy (if (<= 0 tk) (cog-start-miner-topk db-cpt (Number tk))))
+               ;; Record closed and maximal patterns, if required
+               (dummy (if (not (equal? output-mode 'all))
+                          (cog-start-miner-closure db-cpt)))
                (results (cog-fc miner-rbs source))
-               ;; Fetch all relevant results
-               (patterns (fetch-patterns db-cpt ms-n))
-               (patterns-lst (cog-outgoing-set patterns)))
+               ;; Record whether the budget has cut off mining
+               (dummy (set! last-mine-truncated
+                            (cog-miner-budget-exhausted? db-cpt)))
+               (dummy (if last-mine-truncated
+                          (miner-logger-info "Mining has been cut off by the time or memory budget")))
+               (dummy (cog-clear-miner-budget db-cpt))
+               (dummy (cog-clear-miner-progress db-cpt))
+               ;; Write the last checkpoint, so that a truncated run
+               ;; can be resumed
+               (dummy (if checkpoint
+                          (begin (cog-save-miner-checkpoint db-cpt)
+                                 (cog-clear-miner-checkpoint db-cpt))))
+               ;; Free the infrequent patterns recorded while mining
+               (dummy (cog-clear-negative-border db-cpt))
+               ;; Fetch all relevant results, or only the top-k ones
+               (patterns (if (<= 0 tk)
+                             (cog-miner-topk db-cpt)
+                             (fetch-patterns db-cpt ms-n)))
+               (patterns-lst (output-patterns output-mode
+                                              (cog-outgoing-set patterns)
+                                              db-cpt))
+               (dummy (cog-clear-miner-topk db-cpt))
+               (dummy (cog-clear-miner-closure db-cpt)))
 
           (if (equal? su 'none)
 
               ;; No surprisingness, simple return the pattern list
               (let* ((parent-patterns-lst (cog-cp parent-as patterns-lst)))
                 (miner-logger-debug "No surprisingness measure, end pattern miner now")
+                (stop-miner-instrumentation stats trace)
                 (cog-set-atomspace! parent-as)
                 parent-patterns-lst)
 
               ;; Run surprisingness
               (let*
-                  ;; Configure surprisingness backward chainer
                   ((dummy (miner-logger-debug "Call surprisingness on mined patterns"))
 
-                   (surp-rbs (random-surprisingness-rbs-cpt))
-                   (target (surp-target su db-cpt))
-                   (vardecl (surp-vardecl))
-                   (cfg-s (configure-surprisingness surp-rbs su mc db-ratio))
-
-                   ;; Run surprisingness in a backward way
-                   (surp-res (cog-bc surp-rbs target #:vardecl vardecl))
-                   (surp-res-lst (cog-outgoing-set surp-res))
+                   ;; Calculate surprisingness either in a batch, or
+                   ;; with the backward chainer
+                   (surp-res-lst
+                    (if (batch-surprisingness? su)
+                        (batch-surprisingness su patterns-lst db-cpt mc
+                                              db-ratio jobs)
+                        (let* ((surp-rbs (random-surprisingness-rbs-cpt))
+                               (target (surp-target su db-cpt))
+                               (vardecl (surp-vardecl))
+                               (cfg-s (configure-surprisingness surp-rbs su mc db-ratio))
+                               ;; Run surprisingness in a backward way
+                               (surp-res (cog-bc surp-rbs target #:vardecl vardecl)))
+                          (cog-outgoing-set surp-res))))
+                   ;; Free the memos shared by surprisingness calculations
+                   (dummy (cog-clear-surprisingness-mem))
                    (surp-res-sort-lst (desc-sort-by-tv-strength surp-res-lst))
 
                    ;; Copy the results to the parent atomspace
                    (parent-surp-res (cog-cp parent-as surp-res-sort-lst)))
                 (miner-logger-debug "End pattern miner")
+                (stop-miner-instrumentation stats trace)
                 (cog-set-atomspace! parent-as)
                 parent-surp-res))))))
 
@@ -1229,10 +1558,14 @@
     random-surprisingness-rbs-cpt
     get-db-lst
     fill-db-cpt
+    synthetic-kb
     configure-mandatory-rules
     configure-optional-rules
     configure-rules
     configure-surprisingness
+    batch-surprisingness?
+    pattern-conjuncts
+    batch-surprisingness
     surp-target
     surp-vardecl
     configure-miner
@@ -1246,6 +1579,7 @@
     cog-miner-logger
     cog-miner
     cog-mine
+    cog-mine-truncated?
     ;; Functions to allow the rules to run
     shallow-specialization-mv-1-formula
     shallow-specialization-mv-2-formula